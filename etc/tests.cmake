@@ -25,6 +25,25 @@ ttest(net_interface_test_learn)
 ttest(net_interface_test_pending)
 ttest(net_interface_test_expiry)
 ttest(net_interface_test_independence)
+ttest(net_interface_test_per_neighbor)
+ttest(net_interface_test_refresh)
+ttest(net_interface_test_unreachable)
+ttest(net_interface_test_burst)
+ttest(net_interface_test_bounded)
+ttest(net_interface_test_policer)
+ttest(neighbor_table_test)
+ttest(timer_wheel_test)
+ttest(mac_address_test)
+ttest(ready_set_test)
+ttest(codel_queue_test)
+ttest(egress_scheduler_test)
+ttest(spsc_ring_test)
+ttest(seqlock_neighbor_table_test)
+ttest(event_loop_test)
+ttest(tap_device_test)
+ttest(packet_socket_test)
+ttest(udp_batch_test)
+ttest(udp_link_test)
 
 ttest(router_2hosts_1)
 ttest(router_2hosts_2)
@@ -32,8 +51,13 @@ ttest(router_internet)
 ttest(router_hs_network)
 ttest(router_same_network)
 ttest(router_ttl)
+ttest(router_fairness)
+ttest(router_threads)
 
 
 add_custom_target (pa1 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --continue-on-failure --timeout 12 -R '^net_interface')
 
+add_custom_target (speed COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --timeout 120 -R '_speed_test')
+add_test(NAME router_speed_test COMMAND router_speed_test)
+
 add_custom_target (pa2 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --continue-on-failure --timeout 12 -R '^router')
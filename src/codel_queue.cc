@@ -0,0 +1,109 @@
+#include "codel_queue.hh"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace std;
+
+size_t CoDelQueue::frame_size( const EthernetFrame& frame )
+{
+  size_t size = EthernetHeader::LENGTH;
+  for ( const auto& buffer : frame.payload ) {
+    size += buffer.size();
+  }
+  return size;
+}
+
+void CoDelQueue::push( EthernetFrame&& frame, const uint64_t now )
+{
+  const size_t size = frame_size( frame );
+  if ( bytes_ + size > config_.byte_limit ) {
+    ++statistics_.overflow_drops;
+    return;
+  }
+
+  bytes_ += size;
+  items_.push_back( { move( frame ), now, size } );
+}
+
+CoDelQueue::Item CoDelQueue::take_head( const uint64_t now, bool& ok_to_drop )
+{
+  Item item = move( items_.front() );
+  items_.pop_front();
+  bytes_ -= item.bytes;
+
+  const uint64_t sojourn = now - min( item.enqueued, now );
+  ok_to_drop = false;
+  if ( sojourn < config_.target_ms or bytes_ < MAX_FRAME_BYTES ) {
+    // went below target (or nearly empty): stay out of, or leave, the dropping state
+    first_above_time_ = 0;
+  } else if ( first_above_time_ == 0 ) {
+    // just went above target: give it an interval to come back down
+    first_above_time_ = now + config_.interval_ms;
+  } else if ( now >= first_above_time_ ) {
+    ok_to_drop = true;
+  }
+  return item;
+}
+
+// The time of the next drop: an interval / sqrt( count ) after `t`
+uint64_t CoDelQueue::control_law( const uint64_t t ) const
+{
+  return t + static_cast<uint64_t>( static_cast<double>( config_.interval_ms ) / sqrt( max( count_, 1u ) ) );
+}
+
+optional<EthernetFrame> CoDelQueue::pop( const uint64_t now )
+{
+  if ( items_.empty() ) {
+    dropping_ = false;
+    return {};
+  }
+
+  bool ok_to_drop = false;
+  Item item = take_head( now, ok_to_drop );
+
+  if ( dropping_ ) {
+    if ( not ok_to_drop ) {
+      // the delay is back under control
+      dropping_ = false;
+    }
+    // drop as many as the control law says are due, as long as the delay stays high
+    while ( dropping_ and now >= drop_next_ ) {
+      ++statistics_.codel_drops;
+      ++count_;
+      if ( items_.empty() ) {
+        dropping_ = false;
+        return {};
+      }
+      item = take_head( now, ok_to_drop );
+      if ( ok_to_drop ) {
+        drop_next_ = control_law( drop_next_ );
+      } else {
+        dropping_ = false;
+      }
+    }
+  } else if ( ok_to_drop ) {
+    // delay has been above target for a whole interval: enter the dropping state
+    ++statistics_.codel_drops;
+    if ( items_.empty() ) {
+      return {};
+    }
+    item = take_head( now, ok_to_drop );
+    dropping_ = true;
+
+    // if the dropping state was left only recently (perhaps before its next drop was even
+    // due), resume close to the drop rate it had reached, rather than starting over
+    const uint32_t delta = count_ - last_count_;
+    const bool recent = drop_next_ > now or now - drop_next_ < 16 * config_.interval_ms;
+    count_ = ( delta > 1 and recent ) ? delta : 1;
+    drop_next_ = control_law( now );
+    last_count_ = count_;
+  }
+
+  const uint64_t sojourn = now - min( item.enqueued, now );
+  ++statistics_.delay_histogram[min<size_t>( bit_width( sojourn ), DELAY_BUCKETS - 1 )];
+  ++statistics_.sent;
+  statistics_.sent_bytes += item.bytes;
+  return move( item.frame );
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ethernet_frame.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+// A bounded FIFO of outgoing frames with CoDel ("controlled delay") active queue management,
+// after RFC 8289.
+//
+// The queue is bounded in bytes: a frame that would take it over the limit is dropped on
+// arrival. Beyond that, CoDel watches how long frames wait (their sojourn time). As long as
+// some frame gets through within `target` in every `interval`, the queue is only absorbing
+// bursts and nothing is dropped. Once the sojourn time has stayed above target for a whole
+// interval, the queue is a standing one, and CoDel drops frames at the head, at a rate that
+// grows with the square root of the number of drops until the delay comes back down.
+//
+// Time is in milliseconds, as given by the owner on each call.
+class CoDelQueue
+{
+public:
+  struct Config
+  {
+    size_t byte_limit = 256 * 1024; // frames beyond this many bytes are dropped on arrival
+    uint64_t target_ms = 5;         // acceptable standing queue delay
+    uint64_t interval_ms = 100;     // how long the delay may stay above target before dropping
+  };
+
+  // Sojourn times of transmitted frames: bucket 0 counts frames sent within the millisecond
+  // they arrived, and bucket i > 0 those that waited 2^(i-1) to 2^i - 1 ms (the last bucket
+  // takes everything longer)
+  static constexpr size_t DELAY_BUCKETS = 16;
+
+  struct Statistics
+  {
+    uint64_t sent = 0;           // frames that made it through the queue
+    uint64_t sent_bytes = 0;     // ...and their total size
+    uint64_t overflow_drops = 0; // frames dropped on arrival, as the queue was full
+    uint64_t codel_drops = 0;    // frames dropped at the head by CoDel
+    std::array<uint64_t, DELAY_BUCKETS> delay_histogram {};
+  };
+
+  CoDelQueue() = default;
+  explicit CoDelQueue( const Config& config ) : config_( config ) {}
+
+  // Add a frame at the tail (unless the queue is full, in which case it is dropped)
+  void push( EthernetFrame&& frame, uint64_t now );
+
+  // Remove the next frame to transmit, dropping any that CoDel decides to drop on the way
+  std::optional<EthernetFrame> pop( uint64_t now );
+
+  void set_config( const Config& config ) { config_ = config; }
+  const Config& config() const { return config_; }
+  const Statistics& statistics() const { return statistics_; }
+
+  size_t size() const { return items_.size(); }
+  size_t bytes() const { return bytes_; }
+  bool empty() const { return items_.empty(); }
+
+  static size_t frame_size( const EthernetFrame& frame );
+
+private:
+  // CoDel does not drop while the queue holds less than a full-size frame: there would be
+  // nothing to gain by it
+  static constexpr size_t MAX_FRAME_BYTES = EthernetHeader::LENGTH + 1500;
+
+  struct Item
+  {
+    EthernetFrame frame;
+    uint64_t enqueued;
+    size_t bytes;
+  };
+
+  Config config_ {};
+  Statistics statistics_ {};
+  std::deque<Item> items_ {};
+  size_t bytes_ = 0;
+
+  // CoDel state (see RFC 8289, section 5)
+  uint64_t first_above_time_ = 0; // when the delay will have been above target for an interval (0 if below)
+  uint64_t drop_next_ = 0;        // when to drop next, while in the dropping state
+  uint32_t count_ = 0;            // drops since entering the dropping state
+  uint32_t last_count_ = 0;       // count_ when the dropping state was last left
+  bool dropping_ = false;
+
+  // Take the head item off the queue, and say whether CoDel may drop it
+  Item take_head( uint64_t now, bool& ok_to_drop );
+  uint64_t control_law( uint64_t t ) const;
+};
@@ -0,0 +1,103 @@
+#include "egress_scheduler.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+EgressScheduler::Class EgressScheduler::classify( const uint8_t dscp )
+{
+  switch ( dscp ) {
+    case 48: // CS6
+    case 56: // CS7
+      return Class::Control;
+
+    case 46: // EF
+    case 44: // VOICE-ADMIT
+    case 40: // CS5
+      return Class::Realtime;
+
+    case 10: // AF11
+    case 12: // AF12
+    case 14: // AF13
+    case 16: // CS2
+    case 18: // AF21
+    case 20: // AF22
+    case 22: // AF23
+    case 24: // CS3
+    case 26: // AF31
+    case 28: // AF32
+    case 30: // AF33
+    case 32: // CS4
+    case 34: // AF41
+    case 36: // AF42
+    case 38: // AF43
+      return Class::Assured;
+
+    default:
+      // default (0), CS1 (8, lower effort than best effort, but not worth a class of its
+      // own), and any code point not assigned above
+      return Class::BestEffort;
+  }
+}
+
+void EgressScheduler::push( EthernetFrame&& frame, const Class traffic_class, const uint64_t now )
+{
+  queue( traffic_class ).push( move( frame ), now );
+}
+
+optional<EthernetFrame> EgressScheduler::pop( const uint64_t now )
+{
+  // priority classes first (CoDel may drop everything in one, so fall through if it does)
+  for ( size_t c = 0; c < STRICT_CLASSES; c++ ) {
+    if ( not queues_[c].empty() ) {
+      optional<EthernetFrame> frame = queues_[c].pop( now );
+      if ( frame.has_value() ) {
+        return frame;
+      }
+    }
+  }
+
+  // then round-robin: serve the current class until its credit or its frames run out, then
+  // move on (giving up any unused credit). Stop after looking at every class with nothing found.
+  size_t idle = 0;
+  while ( idle <= CLASSES - STRICT_CLASSES ) {
+    CoDelQueue& current = queues_[current_];
+    if ( credit_ > 0 and not current.empty() ) {
+      optional<EthernetFrame> frame = current.pop( now );
+      if ( frame.has_value() ) {
+        --credit_;
+        return frame;
+      }
+    }
+
+    current_ = current_ + 1 < CLASSES ? current_ + 1 : STRICT_CLASSES;
+    credit_ = weights_[current_];
+    ++idle;
+  }
+  return {};
+}
+
+void EgressScheduler::set_weight( const Class traffic_class, const unsigned weight )
+{
+  const size_t c = static_cast<size_t>( traffic_class );
+  if ( c < STRICT_CLASSES or c >= CLASSES ) {
+    throw runtime_error( "EgressScheduler: only round-robin classes have a weight" );
+  }
+  if ( weight == 0 ) {
+    throw runtime_error( "EgressScheduler: weight must be at least 1" );
+  }
+  weights_[c] = weight;
+  if ( current_ == c ) {
+    credit_ = min( credit_, weight );
+  }
+}
+
+size_t EgressScheduler::size() const
+{
+  size_t size = 0;
+  for ( const auto& queue : queues_ ) {
+    size += queue.size();
+  }
+  return size;
+}
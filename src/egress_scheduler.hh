@@ -0,0 +1,59 @@
+#pragma once
+
+#include "codel_queue.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+// The transmit side of a NetworkInterface: a queue per traffic class, selected by DSCP.
+//
+// Control traffic (ARP, and network control marked CS6/CS7) and real-time traffic (EF, VA and
+// CS5, e.g. voice) are served by strict priority, in that order. Whatever they leave is shared
+// by assured (AF, and CS2-CS4) and best-effort traffic by weighted round-robin,
+// in frames (4:1 by default). Each class has its own CoDelQueue, and so its own byte limit,
+// CoDel parameters and counters. The priority classes are kept short, which bounds how long
+// their traffic can wait, and how long it can hold up the rest.
+class EgressScheduler
+{
+public:
+  enum class Class : uint8_t
+  {
+    Control,
+    Realtime,
+    Assured,
+    BestEffort,
+  };
+  static constexpr size_t CLASSES = 4;
+
+  // Traffic class for a DSCP value (the top six bits of the IPv4 type-of-service byte)
+  static Class classify( uint8_t dscp );
+
+  void push( EthernetFrame&& frame, Class traffic_class, uint64_t now );
+
+  // Remove the next frame to transmit (dropping any that CoDel decides to drop on the way)
+  std::optional<EthernetFrame> pop( uint64_t now );
+
+  CoDelQueue& queue( Class traffic_class ) { return queues_[static_cast<size_t>( traffic_class )]; }
+  const CoDelQueue& queue( Class traffic_class ) const { return queues_[static_cast<size_t>( traffic_class )]; }
+
+  // Set the share of a round-robin class (Assured or BestEffort), in frames per round
+  void set_weight( Class traffic_class, unsigned weight );
+
+  size_t size() const;
+  bool empty() const { return size() == 0; }
+
+private:
+  static constexpr size_t STRICT_CLASSES = 2; // Control and Realtime
+
+  std::array<CoDelQueue, CLASSES> queues_ { CoDelQueue { { .byte_limit = 16 * 1024 } },
+                                            CoDelQueue { { .byte_limit = 64 * 1024 } },
+                                            CoDelQueue { { .byte_limit = 256 * 1024 } },
+                                            CoDelQueue { { .byte_limit = 256 * 1024 } } };
+  std::array<unsigned, CLASSES> weights_ { 0, 0, 4, 1 };
+
+  // Round-robin position: the class being served, and how many more frames it may send
+  size_t current_ = STRICT_CLASSES;
+  unsigned credit_ = weights_[STRICT_CLASSES];
+};
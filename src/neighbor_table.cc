@@ -0,0 +1,130 @@
+#include "neighbor_table.hh"
+
+#include <bit>
+#include <stdexcept>
+
+using namespace std;
+
+// capacity: number of entries the table should hold before its first resize
+NeighborTable::NeighborTable( const size_t capacity )
+  : slots_( bit_ceil( max<size_t>( capacity * 2, 16 ) ) )
+  , mask_( slots_.size() - 1 )
+  , shift_( 64 - countr_zero( slots_.size() ) )
+{}
+
+size_t NeighborTable::home( const uint32_t ip ) const
+{
+  constexpr uint64_t golden_ratio = 0x9e3779b97f4a7c15;
+  return static_cast<size_t>( ( ip * golden_ratio ) >> shift_ );
+}
+
+NeighborTable::Entry* NeighborTable::find( const uint32_t ip )
+{
+  for ( size_t index = home( ip );; index = ( index + 1 ) & mask_ ) {
+    Entry& entry = slots_[index];
+    if ( entry.state == State::Empty ) {
+      return nullptr;
+    }
+    if ( entry.ip == ip ) {
+      return &entry;
+    }
+  }
+}
+
+const NeighborTable::Entry* NeighborTable::find( const uint32_t ip ) const
+{
+  return const_cast<NeighborTable*>( this )->find( ip ); // NOLINT(*-const-cast)
+}
+
+// initial: the state of a new entry, set along with its address so that the table is never
+// left with a counted entry that lookups would take for the end of a probe run
+pair<NeighborTable::Entry*, bool> NeighborTable::find_or_insert( const uint32_t ip, const State initial )
+{
+  if ( initial == State::Empty ) {
+    throw runtime_error( "NeighborTable: a new entry cannot be Empty" );
+  }
+
+  // keep the load factor at or below 1/2 so that probe runs stay short
+  if ( ( size_ + 1 ) * 2 > slots_.size() ) {
+    grow();
+  }
+
+  for ( size_t index = home( ip );; index = ( index + 1 ) & mask_ ) {
+    Entry& entry = slots_[index];
+    if ( entry.state == State::Empty ) {
+      entry.ip = ip;
+      entry.state = initial;
+      ++size_;
+      return { &entry, true };
+    }
+    if ( entry.ip == ip ) {
+      return { &entry, false };
+    }
+  }
+}
+
+void NeighborTable::erase( const uint32_t ip )
+{
+  Entry* entry = find( ip );
+  if ( entry ) {
+    erase_slot( entry - slots_.data() );
+  }
+}
+
+NeighborTable::Entry NeighborTable::evict()
+{
+  while ( true ) {
+    hand_ = ( hand_ + 1 ) & mask_;
+    Entry& entry = slots_[hand_];
+    if ( entry.state == State::Empty ) {
+      continue;
+    }
+    if ( entry.flags & FLAG_REFERENCED ) {
+      entry.flags &= ~FLAG_REFERENCED;
+      continue;
+    }
+
+    const Entry victim = entry;
+    erase_slot( hand_ );
+    return victim;
+  }
+}
+
+void NeighborTable::grow()
+{
+  const vector<Entry> old = move( slots_ );
+  slots_ = vector<Entry>( old.size() * 2 );
+  mask_ = slots_.size() - 1;
+  --shift_;
+
+  for ( size_t old_index = 0; old_index < old.size(); old_index++ ) {
+    if ( old[old_index].state == State::Empty ) {
+      continue;
+    }
+    size_t index = home( old[old_index].ip );
+    while ( slots_[index].state != State::Empty ) {
+      index = ( index + 1 ) & mask_;
+    }
+    slots_[index] = old[old_index];
+  }
+}
+
+// Backward-shift deletion: walk the probe run after the hole and move back every entry
+// whose home slot does not lie between the hole and its current position.
+void NeighborTable::erase_slot( size_t index )
+{
+  size_t next = index;
+  while ( true ) {
+    next = ( next + 1 ) & mask_;
+    if ( slots_[next].state == State::Empty ) {
+      break;
+    }
+    const size_t next_home = home( slots_[next].ip );
+    if ( ( ( next - next_home ) & mask_ ) >= ( ( next - index ) & mask_ ) ) {
+      slots_[index] = slots_[next];
+      index = next;
+    }
+  }
+  slots_[index] = Entry {};
+  --size_;
+}
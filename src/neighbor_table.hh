@@ -0,0 +1,122 @@
+#pragma once
+
+#include "ethernet_header.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// The neighbor table (ARP cache) of a NetworkInterface: a flat, open-addressed hash
+// table from IPv4 address to Ethernet address.
+//
+// Entries are packed into 16 bytes and aligned so that four of them share a cache line
+// and none straddles two. Collisions are resolved by linear probing, and erasing an entry
+// shifts the rest of its probe run back instead of leaving a tombstone, so runs stay short
+// and a lookup normally touches a single cache line. Everything needed to address a frame
+// to the neighbor is in its entry, so sending touches no other memory.
+class NeighborTable
+{
+public:
+  enum class State : uint8_t
+  {
+    Empty = 0,  // slot is unused
+    Incomplete, // an ARP request is outstanding; the Ethernet address is unknown
+    Reachable,  // the Ethernet address was learned from an ARP message
+    Failed,     // recent requests went unanswered (a negative cache entry)
+  };
+
+  // The Ethernet address shares a word with the state and flags: a MacAddress needs only
+  // its low 48 bits, and the word is compared and copied as a whole.
+  struct alignas( 16 ) Entry
+  {
+    uint32_t ip {};        // IPv4 address of the neighbor (host byte order)
+    uint32_t timestamp {}; // interface time (ms, modulo 2^32) of the last state change
+    uint64_t mac : 48 {};  // MacAddress::value() of the neighbor, valid when state is Reachable
+    State state : 8 {};
+    uint8_t flags : 8 {}; // FLAG_* bits, and the count of consecutive failed requests in the high nibble
+
+    MacAddress ethernet_address() const { return MacAddress::from_integer( mac ); }
+    void set_ethernet_address( const MacAddress address ) { mac = address.value(); }
+
+    unsigned failures() const { return flags >> 4; }
+    void set_failures( unsigned n ) { flags = static_cast<uint8_t>( ( flags & 0x0f ) | ( std::min( n, 15u ) << 4 ) ); }
+  };
+
+  // The entry has been used to send a datagram since it was last confirmed
+  static constexpr uint8_t FLAG_USED = 1;
+  // The entry has been used since the CLOCK hand last passed it (see evict())
+  static constexpr uint8_t FLAG_REFERENCED = 2;
+
+  static_assert( sizeof( Entry ) == 16 );
+
+  // Construct a table with room for at least `capacity` entries before it has to grow
+  explicit NeighborTable( size_t capacity = 64 );
+
+  // Look up the entry for `ip` (or nullptr if there is none)
+  Entry* find( uint32_t ip );
+  const Entry* find( uint32_t ip ) const;
+
+  // Look up the entry for `ip`, creating one in state `initial` (which must not be Empty) if
+  // necessary. The bool is true if the entry was created by this call.
+  // Pointers to entries are invalidated by any later insertion or erasure.
+  std::pair<Entry*, bool> find_or_insert( uint32_t ip, State initial );
+
+  // Remove the entry for `ip`, if there is one
+  void erase( uint32_t ip );
+
+  // Remove an entry to make room for another, and return it. Entries are chosen in CLOCK
+  // order: a hand sweeps the table, sparing (and clearing) entries with FLAG_REFERENCED set
+  // and taking the first one without it. The table must not be empty.
+  Entry evict();
+
+  // Remove every entry for which `pred( entry )` returns true
+  template<class Predicate>
+  void erase_if( Predicate&& pred );
+
+  // Call `visit( entry )` on every entry, in no particular order
+  template<class Visitor>
+  void for_each( Visitor&& visit ) const;
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  std::vector<Entry> slots_;
+  size_t mask_;
+  int shift_;
+  size_t size_ {};
+  size_t hand_ {}; // CLOCK hand
+
+  // Home slot of `ip` (Fibonacci hashing: takes the top bits of ip * 2^64/phi, which spreads
+  // consecutive addresses evenly across the table)
+  size_t home( uint32_t ip ) const;
+
+  void grow();
+  void erase_slot( size_t index );
+};
+
+template<class Predicate>
+void NeighborTable::erase_if( Predicate&& pred )
+{
+  size_t index = 0;
+  while ( index < slots_.size() ) {
+    // erase_slot() may shift a later entry into `index`, so only advance when nothing moved
+    if ( slots_[index].state != State::Empty and pred( slots_[index] ) ) {
+      erase_slot( index );
+    } else {
+      ++index;
+    }
+  }
+}
+
+template<class Visitor>
+void NeighborTable::for_each( Visitor&& visit ) const
+{
+  for ( const Entry& entry : slots_ ) {
+    if ( entry.state != State::Empty ) {
+      visit( entry );
+    }
+  }
+}
@@ -2,12 +2,16 @@
 
 #include "arp_message.hh"
 #include "ethernet_frame.hh"
+
+#include <algorithm>
+#include <stdexcept>
+
 using namespace std;
 
 
 // ethernet_address: Ethernet (what ARP calls "hardware") address of the interface
 // ip_address: IP (what ARP calls "protocol") address of the interface
-NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, const Address& ip_address )
+NetworkInterface::NetworkInterface( const MacAddress ethernet_address, const Address& ip_address )
   : ethernet_address_( ethernet_address ), ip_address_( ip_address )
 {
   cerr << "DEBUG: Network interface has Ethernet address " << to_string( ethernet_address_ ) << " and IP address "
@@ -24,46 +28,299 @@ NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, con
 void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Address& next_hop )
 {
   const uint32_t next_hop_ip = next_hop.ipv4_numeric();
-  
-  if (arp_table.contains(next_hop_ip)) {
-    EthernetFrame frame = EthernetFrame();
-    frame.header.type = EthernetHeader::TYPE_IPv4;
-    frame.header.src = ethernet_address_;
-    frame.header.dst = arp_table[next_hop_ip].first;
-    Serializer serializer;
-    dgram.serialize(serializer);
-    frame.payload = move(serializer.output());
-    ready_to_be_sent.push(frame);
+  NeighborTable::Entry* entry = arp_table.find( next_hop_ip );
+
+  if ( entry != nullptr and entry->state == NeighborTable::State::Reachable ) {
+    mark_in_use( *entry );
+    send_ipv4_frame( dgram, entry->ethernet_address() );
+
+  } else if ( not may_solicit( entry ) ) {
+    // too many neighbors are being resolved already
+    ++statistics_.resolution_limit_drops;
+
+  } else if ( solicit( next_hop_ip, entry ) ) {
+    enqueue_pending( next_hop_ip, dgram );
 
   } else {
-    arp_queue.push(next_hop_ip);
-    if (arp_requests.find(next_hop_ip) == arp_requests.end() || (timer - arp_requests[next_hop_ip] > 5000) ){
-      send_arp_request();
-      arp_requests[next_hop_ip] = timer;
+    // known to be unreachable: don't spend queue memory or broadcasts on it
+    ++statistics_.unreachable_drops;
+  }
+}
+
+void NetworkInterface::send_ipv4_frame( const InternetDatagram& dgram, const MacAddress dst )
+{
+  EthernetFrame frame { { dst, ethernet_address_, EthernetHeader::TYPE_IPv4 }, {} };
+  Serializer serializer;
+  dgram.serialize( serializer );
+  frame.payload = move( serializer.output() );
+  ready_to_be_sent.push( move( frame ), EgressScheduler::classify( dgram.header.tos >> 2 ), timer );
+}
+
+void NetworkInterface::mark_in_use( NeighborTable::Entry& entry )
+{
+  constexpr uint8_t in_use = NeighborTable::FLAG_USED | NeighborTable::FLAG_REFERENCED;
+  if ( ( entry.flags & in_use ) != in_use ) {
+    entry.flags |= in_use;
+  }
+}
+
+bool NetworkInterface::build_frame( const InternetDatagram& dgram, const uint32_t next_hop_ip, EthernetFrame& frame ) const
+{
+  if ( not shared_neighbors_ ) {
+    return false;
+  }
+  const optional<MacAddress> ethernet_address = shared_neighbors_->find( next_hop_ip );
+  if ( not ethernet_address.has_value() ) {
+    return false;
+  }
+
+  frame.header = { *ethernet_address, ethernet_address_, EthernetHeader::TYPE_IPv4 };
+  Serializer serializer;
+  dgram.serialize( serializer );
+  frame.payload = move( serializer.output() );
+  return true;
+}
+
+// The frame was addressed by the shared table, which follows this interface's own, so the
+// mapping is still learned (short of having been evicted since, which does no harm)
+void NetworkInterface::send_frame( EthernetFrame&& frame, const uint32_t next_hop_ip, const uint8_t tos )
+{
+  NeighborTable::Entry* entry = arp_table.find( next_hop_ip );
+  if ( entry != nullptr and entry->state == NeighborTable::State::Reachable ) {
+    mark_in_use( *entry );
+  }
+  ready_to_be_sent.push( move( frame ), EgressScheduler::classify( tos >> 2 ), timer );
+}
+
+size_t NetworkInterface::datagram_size( const InternetDatagram& dgram )
+{
+  size_t size = IPv4Header::LENGTH;
+  for ( const auto& buffer : dgram.payload ) {
+    size += buffer.size();
+  }
+  return size;
+}
+
+// Hold a datagram until `next_hop_ip` resolves. If that neighbor already has its fill of
+// waiting datagrams, the oldest ones are dropped to make room.
+void NetworkInterface::enqueue_pending( const uint32_t next_hop_ip, const InternetDatagram& dgram )
+{
+  PendingQueue& pending = pending_datagrams_[next_hop_ip];
+  pending.bytes += datagram_size( dgram );
+  pending.datagrams.push( dgram );
+
+  while ( pending.datagrams.size() > MAX_PENDING_DATAGRAMS
+          or ( pending.bytes > MAX_PENDING_BYTES and pending.datagrams.size() > 1 ) ) {
+    pending.bytes -= datagram_size( pending.datagrams.front() );
+    pending.datagrams.pop();
+    ++statistics_.pending_drops;
+  }
+}
+
+// Give up on everything that was waiting for `ip`
+void NetworkInterface::drop_pending( const uint32_t ip )
+{
+  auto it = pending_datagrams_.find( ip );
+  if ( it != pending_datagrams_.end() ) {
+    statistics_.pending_drops += it->second.datagrams.size();
+    pending_datagrams_.erase( it );
+  }
+}
+
+// Send everything that was waiting for `ip`, now that it has resolved to `dst`
+void NetworkInterface::flush_pending( const uint32_t ip, const MacAddress dst )
+{
+  auto it = pending_datagrams_.find( ip );
+  if ( it == pending_datagrams_.end() ) {
+    return;
+  }
+
+  PendingQueue pending = move( it->second );
+  pending_datagrams_.erase( it );
+  while ( not pending.datagrams.empty() ) {
+    send_ipv4_frame( pending.datagrams.front(), dst );
+    pending.datagrams.pop();
+  }
+}
+
+void NetworkInterface::resolve( const Address& next_hop )
+{
+  const uint32_t next_hop_ip = next_hop.ipv4_numeric();
+  NeighborTable::Entry* entry = arp_table.find( next_hop_ip );
+  if ( ( entry == nullptr or entry->state != NeighborTable::State::Reachable ) and may_solicit( entry ) ) {
+    solicit( next_hop_ip, entry );
+  }
+}
+
+// Is there room to start resolving this (possibly not yet known) neighbor?
+bool NetworkInterface::may_solicit( const NeighborTable::Entry* entry ) const
+{
+  return ( entry != nullptr and entry->state == NeighborTable::State::Incomplete )
+         or incomplete_neighbors_ < max_incomplete_neighbors_;
+}
+
+// Record that `entry` is at `ethernet_address`, and send whatever was waiting for it
+void NetworkInterface::learn_neighbor( NeighborTable::Entry& entry, const MacAddress ethernet_address )
+{
+  entry.set_ethernet_address( ethernet_address );
+  set_neighbor_state( entry, NeighborTable::State::Reachable );
+  if ( shared_neighbors_ ) {
+    shared_neighbors_->store( entry.ip, ethernet_address );
+  }
+  flush_pending( entry.ip, ethernet_address );
+}
+
+shared_ptr<const SeqlockNeighborTable> NetworkInterface::share_neighbors( const size_t capacity )
+{
+  if ( not shared_neighbors_ ) {
+    shared_neighbors_ = make_shared<SeqlockNeighborTable>( capacity );
+    arp_table.for_each( [&]( const NeighborTable::Entry& entry ) {
+      if ( entry.state == NeighborTable::State::Reachable ) {
+        shared_neighbors_->store( entry.ip, entry.ethernet_address() );
+      }
+    } );
+  }
+  return shared_neighbors_;
+}
+
+void NetworkInterface::unshare_neighbor( const uint32_t ip )
+{
+  if ( shared_neighbors_ ) {
+    shared_neighbors_->erase( ip );
+  }
+}
+
+// Add a neighbor to the table in `state`, evicting a cold one if the table is full
+NeighborTable::Entry& NetworkInterface::add_neighbor( const uint32_t ip, const NeighborTable::State state )
+{
+  if ( arp_table.size() >= max_neighbors_ ) {
+    evict_neighbor();
+  }
+
+  NeighborTable::Entry& entry = *arp_table.find_or_insert( ip, state ).first;
+  entry.flags |= NeighborTable::FLAG_REFERENCED;
+  change_neighbor_state( entry, NeighborTable::State::Empty, state );
+  return entry;
+}
+
+void NetworkInterface::evict_neighbor()
+{
+  const NeighborTable::Entry victim = arp_table.evict();
+  if ( victim.state == NeighborTable::State::Reachable ) {
+    unshare_neighbor( victim.ip );
+  }
+  if ( victim.state == NeighborTable::State::Incomplete ) {
+    --incomplete_neighbors_;
+    drop_pending( victim.ip );
+  }
+  ++statistics_.neighbor_evictions;
+}
+
+void NetworkInterface::set_neighbor_limits( const size_t max_neighbors, const size_t max_incomplete )
+{
+  if ( max_neighbors == 0 or max_incomplete == 0 ) {
+    throw runtime_error( "NetworkInterface: neighbor limits must be at least 1" );
+  }
+
+  max_neighbors_ = max_neighbors;
+  max_incomplete_neighbors_ = max_incomplete;
+  while ( arp_table.size() > max_neighbors_ ) {
+    evict_neighbor();
+  }
+}
+
+// entry: the neighbor's entry, or nullptr if it has none yet
+bool NetworkInterface::solicit( const uint32_t ip, NeighborTable::Entry* entry )
+{
+  if ( entry == nullptr ) {
+    add_neighbor( ip, NeighborTable::State::Incomplete );
+    send_arp_request( ip );
+    return true;
+  }
+  if ( entry->state == NeighborTable::State::Incomplete ) {
+    return true;
+  }
+  if ( entry->state == NeighborTable::State::Failed and age( *entry ) < hold_down_ms( entry->failures() ) ) {
+    return false;
+  }
+
+  set_neighbor_state( *entry, NeighborTable::State::Incomplete );
+  send_arp_request( ip );
+  return true;
+}
+
+size_t NetworkInterface::hold_down_ms( const unsigned failures )
+{
+  if ( failures <= 1 ) {
+    return 0;
+  }
+  return min( ARP_REQUEST_TIMEOUT_MS << min( failures - 2, 16u ), ARP_MAX_HOLD_DOWN_MS );
+}
+
+uint32_t NetworkInterface::age( const NeighborTable::Entry& entry ) const
+{
+  return static_cast<uint32_t>( timer ) - entry.timestamp;
+}
+
+void NetworkInterface::set_neighbor_state( NeighborTable::Entry& entry, const NeighborTable::State state )
+{
+  change_neighbor_state( entry, entry.state, state );
+}
+
+// from: the state the entry is leaving (Empty for one just added, already in `state`)
+void NetworkInterface::change_neighbor_state( NeighborTable::Entry& entry,
+                                              const NeighborTable::State from,
+                                              const NeighborTable::State state )
+{
+  if ( from == NeighborTable::State::Incomplete ) {
+    --incomplete_neighbors_;
+  }
+  if ( from == NeighborTable::State::Reachable and state != NeighborTable::State::Reachable ) {
+    unshare_neighbor( entry.ip );
+  }
+  if ( state == NeighborTable::State::Incomplete ) {
+    ++incomplete_neighbors_;
+  }
+
+  entry.state = state;
+  entry.timestamp = static_cast<uint32_t>( timer );
+  // a confirmed mapping also ends any backoff
+  entry.flags &= state == NeighborTable::State::Reachable ? NeighborTable::FLAG_REFERENCED : ~NeighborTable::FLAG_USED;
+
+  // deadlines are "more than N ms" after the change, hence the + 1
+  if ( state == NeighborTable::State::Reachable ) {
+    neighbor_timers_.schedule(
+      timer + ARP_ENTRY_TTL_MS + 1, entry.ip, static_cast<uint32_t>( NeighborTimer::EntryExpiry ) );
+    if ( refresh_neighbors_ ) {
+      neighbor_timers_.schedule(
+        timer + ARP_ENTRY_TTL_MS - ARP_REFRESH_LEAD_MS, entry.ip, static_cast<uint32_t>( NeighborTimer::Refresh ) );
     }
-    packet_queue.push(dgram);    
+  } else if ( state == NeighborTable::State::Incomplete ) {
+    neighbor_timers_.schedule(
+      timer + ARP_REQUEST_TIMEOUT_MS + 1, entry.ip, static_cast<uint32_t>( NeighborTimer::RequestTimeout ) );
+  } else if ( state == NeighborTable::State::Failed ) {
+    neighbor_timers_.schedule(
+      timer + ARP_FAILED_TTL_MS + 1, entry.ip, static_cast<uint32_t>( NeighborTimer::FailedExpiry ) );
   }
 }
 
-void NetworkInterface::send_arp_request() {
+void NetworkInterface::send_arp_request( const uint32_t target_ip, const MacAddress dst ) {
   ARPMessage arp_msg;
   arp_msg.opcode = ARPMessage::OPCODE_REQUEST;
   arp_msg.sender_ethernet_address = ethernet_address_;
   arp_msg.sender_ip_address = ip_address_.ipv4_numeric();
-  arp_msg.target_ethernet_address = {0, 0, 0, 0, 0, 0};
-  uint32_t target_ip_addr = arp_queue.front();
-  arp_queue.pop(); 
-  arp_msg.target_ip_address = target_ip_addr; 
+  arp_msg.target_ethernet_address = {};
+  arp_msg.target_ip_address = target_ip;
 
   // Send ARP request
   EthernetFrame frame;
   frame.header.type = EthernetHeader::TYPE_ARP;
   frame.header.src = ethernet_address_;
-  frame.header.dst = ETHERNET_BROADCAST;
+  frame.header.dst = dst;
   Serializer serializer;
   arp_msg.serialize(serializer);
   frame.payload = move(serializer.output());
-  ready_to_be_sent.push(frame);
+  ready_to_be_sent.push( move( frame ), EgressScheduler::Class::Control, timer );
 }
 
 
@@ -71,110 +328,220 @@ void NetworkInterface::send_arp_request() {
 // frame: the incoming Ethernet frame
 optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& frame )
 {
-  if (!ethernet_address_equal(frame.header.dst, ETHERNET_BROADCAST) && !ethernet_address_equal(frame.header.dst, ethernet_address_)) {
+  if ( not accepts( frame.header ) ) {
     return {};
-  
+
   // IPv4
   } else if (frame.header.type == EthernetHeader::TYPE_IPv4){
+    if ( not police( frame ) ) {
+      return {};
+    }
     InternetDatagram datagram;
-    Parser parser = Parser(frame.payload);
-    datagram.parse(parser);
-    return datagram;
-    
+    if ( parse( datagram, frame.payload ) ) {
+      return datagram;
+    }
 
   // ARP
   } else if (frame.header.type == EthernetHeader::TYPE_ARP){
-    ARPMessage msg;
-    Parser parser = Parser(frame.payload);
+    recv_arp( frame );
+  }
 
-    if (!parser.has_error()){
-      msg.parse(parser);
+  return {};
+}
 
+// frames: a burst of incoming Ethernet frames
+// datagrams: where to append the IPv4 datagrams among them
+size_t NetworkInterface::recv_frames( const span<const EthernetFrame> frames, vector<InternetDatagram>& datagrams )
+{
+  // one pass to sort the burst: ARP is handled on the spot, IPv4 is set aside
+  burst_ipv4_frames_.clear();
+  for ( const auto& frame : frames ) {
+    if ( not accepts( frame.header ) ) {
+      continue;
     }
-    if (msg.supported()) { 
-      arp_table[msg.sender_ip_address] = pair(msg.sender_ethernet_address, timer);
-      // arp reply
-      if (msg.opcode == ARPMessage::OPCODE_REQUEST && msg.target_ip_address == ip_address_.ipv4_numeric()){
-        ARPMessage reply_msg;
-        reply_msg.opcode = ARPMessage::OPCODE_REPLY;
-        reply_msg.sender_ethernet_address = ethernet_address_;
-        reply_msg.sender_ip_address = ip_address_.ipv4_numeric();
-        reply_msg.target_ethernet_address = msg.sender_ethernet_address;
-        reply_msg.target_ip_address = msg.sender_ip_address;
-
-        EthernetFrame eth_frame;
-        eth_frame.header.type = EthernetHeader::TYPE_ARP;
-        eth_frame.header.src = ethernet_address_;
-        eth_frame.header.dst = frame.header.src;
-        Serializer serializer;
-        reply_msg.serialize(serializer);
-        eth_frame.payload = move(serializer.output());
-        ready_to_be_sent.push(eth_frame);
-        }
-
-        while(!packet_queue.empty()){
-          InternetDatagram packet = packet_queue.front();
-          packet_queue.pop();
-          EthernetFrame eth_frame = EthernetFrame();
-          eth_frame.header.type = EthernetHeader::TYPE_IPv4;
-          eth_frame.header.src = ethernet_address_;
-          eth_frame.header.dst = msg.sender_ethernet_address;
-          Serializer serializer;
-          packet.serialize(serializer);
-          eth_frame.payload = move(serializer.output());
-          ready_to_be_sent.push(eth_frame);    
-        
-        }
+    if ( frame.header.type == EthernetHeader::TYPE_IPv4 ) {
+      if ( police( frame ) ) {
+        burst_ipv4_frames_.push_back( &frame );
       }
+    } else if ( frame.header.type == EthernetHeader::TYPE_ARP ) {
+      recv_arp( frame );
+    }
   }
 
-  return {};
+  // then the datagrams, parsed straight into the caller's vector
+  const size_t before = datagrams.size();
+  for ( const EthernetFrame* frame : burst_ipv4_frames_ ) {
+    if ( not parse( datagrams.emplace_back(), frame->payload ) ) {
+      datagrams.pop_back();
+    }
+  }
+  return datagrams.size() - before;
 }
 
-bool NetworkInterface::ethernet_address_equal(EthernetAddress addr1, EthernetAddress addr2) {
-  for (int i = 0; i < 6; i++) {
-    if (addr1[i] != addr2[i]) {
-      return false;
-    }
+// Is the frame addressed to this interface (directly or by broadcast)?
+bool NetworkInterface::accepts( const EthernetHeader& header ) const
+{
+  return header.dst == ethernet_address_ or header.dst.is_broadcast();
+}
+
+// Is an IPv4 frame within the ingress rate limits? If so, it is charged against them.
+bool NetworkInterface::police( const EthernetFrame& frame )
+{
+  TokenBucket* class_policer = nullptr;
+  if ( any_of( class_policers_.begin(), class_policers_.end(), []( const auto& p ) { return p.has_value(); } ) ) {
+    // the DSCP is in the second byte of the IPv4 header; no need to parse the rest
+    const string_view header = frame.payload.empty() ? string_view {} : string_view { frame.payload.front() };
+    const uint8_t dscp = header.size() > 1 ? static_cast<uint8_t>( header[1] ) >> 2 : 0;
+    auto& policer = class_policers_[static_cast<size_t>( EgressScheduler::classify( dscp ) )];
+    class_policer = policer.has_value() ? &*policer : nullptr;
+  }
+  if ( class_policer == nullptr and not ingress_policer_.has_value() ) {
+    return true;
+  }
+
+  const size_t size = CoDelQueue::frame_size( frame ) - EthernetHeader::LENGTH;
+  if ( ( class_policer != nullptr and not class_policer->conforms( size ) )
+       or ( ingress_policer_.has_value() and not ingress_policer_->conforms( size ) ) ) {
+    ++statistics_.policer_drops;
+    return false;
+  }
+
+  if ( class_policer != nullptr ) {
+    class_policer->consume( size );
+  }
+  if ( ingress_policer_.has_value() ) {
+    ingress_policer_->consume( size );
   }
   return true;
 }
 
+// Learn from an ARP message, and answer it if it is a request for our address
+void NetworkInterface::recv_arp( const EthernetFrame& frame )
+{
+  ARPMessage msg;
+  if ( not parse( msg, frame.payload ) or not msg.supported() ) {
+    return;
+  }
+
+  const bool for_us = msg.target_ip_address == ip_address_.ipv4_numeric();
+
+  // Learn from the sender if it is already in the cache, or if the message is meant for
+  // us (as in RFC 826), so that unsolicited ARP traffic cannot fill up the table. A probe
+  // (RFC 5227) has no sender address yet, and there is nothing to learn from it.
+  const bool probe = msg.sender_ip_address == 0;
+  NeighborTable::Entry* entry = probe ? nullptr : arp_table.find( msg.sender_ip_address );
+  if ( entry == nullptr and for_us and not probe ) {
+    entry = &add_neighbor( msg.sender_ip_address, NeighborTable::State::Reachable );
+  }
+
+  // arp reply
+  if (msg.opcode == ARPMessage::OPCODE_REQUEST && for_us){
+    ARPMessage reply_msg;
+    reply_msg.opcode = ARPMessage::OPCODE_REPLY;
+    reply_msg.sender_ethernet_address = ethernet_address_;
+    reply_msg.sender_ip_address = ip_address_.ipv4_numeric();
+    reply_msg.target_ethernet_address = msg.sender_ethernet_address;
+    reply_msg.target_ip_address = msg.sender_ip_address;
+
+    EthernetFrame eth_frame;
+    eth_frame.header.type = EthernetHeader::TYPE_ARP;
+    eth_frame.header.src = ethernet_address_;
+    eth_frame.header.dst = frame.header.src;
+    Serializer serializer;
+    reply_msg.serialize(serializer);
+    eth_frame.payload = move(serializer.output());
+    ready_to_be_sent.push( move( eth_frame ), EgressScheduler::Class::Control, timer );
+  }
+
+  if ( entry != nullptr ) {
+    learn_neighbor( *entry, msg.sender_ethernet_address );
+  }
+}
+
 // ms_since_last_tick: the number of milliseconds since the last call to this method
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
   timer += ms_since_last_tick;
 
-  // Expire any entry in ARP cache table that was learnt more than 30 seconds ago.
-  list<uint32_t> arp_expired;
-
-  for(auto elem = arp_table.begin(); elem != arp_table.end(); ++elem) {
-    if (timer - elem->second.second > 30000){
-        arp_expired.push_back(elem->first); 
+  if ( ingress_policer_.has_value() ) {
+    ingress_policer_->refill( ms_since_last_tick );
+  }
+  for ( auto& policer : class_policers_ ) {
+    if ( policer.has_value() ) {
+      policer->refill( ms_since_last_tick );
     }
   }
-  for (auto key : arp_expired) {
-      arp_table.erase(key);
+
+  // Expire ARP cache entries and requests whose deadlines have passed. Only timers that
+  // fire are visited, so this costs nothing when no deadline is near.
+  expired_timers_.clear();
+  neighbor_timers_.advance( timer, expired_timers_ );
+  for ( const auto& fired : expired_timers_ ) {
+    neighbor_timer_fired( fired );
+  }
+}
+
+void NetworkInterface::neighbor_timer_fired( const TimerWheel::Timer& fired )
+{
+  NeighborTable::Entry* entry = arp_table.find( fired.key );
+  if ( entry == nullptr ) {
+    return;
   }
 
-  // Remove the pending ARP reply wait for any next hop IP that was sent more than 5 seconds ago. Furthermore, you should also empty any packets waiting for that IP address from the queue.
-  for (auto elem = arp_requests.begin(); elem != arp_requests.end(); ++elem){
-    if (timer - elem->second > 5000) {
-      // while()
-      InternetDatagram packet = packet_queue.front();
-      if (packet.header.dst == elem->first){
-        packet_queue.pop();
+  switch ( static_cast<NeighborTimer>( fired.tag ) ) {
+    // a mapping learnt more than 30 seconds ago (and not refreshed since)
+    case NeighborTimer::EntryExpiry:
+      if ( entry->state == NeighborTable::State::Reachable and age( *entry ) > ARP_ENTRY_TTL_MS ) {
+        unshare_neighbor( fired.key );
+        arp_table.erase( fired.key );
       }
-    }
+      break;
+
+    // a request unanswered for more than 5 seconds: drop the datagrams that were waiting
+    // for that neighbor, and mark it failed (so the next attempt, if any, backs off)
+    case NeighborTimer::RequestTimeout:
+      if ( entry->state == NeighborTable::State::Incomplete and age( *entry ) > ARP_REQUEST_TIMEOUT_MS ) {
+        drop_pending( fired.key );
+        entry->set_failures( entry->failures() + 1 );
+        set_neighbor_state( *entry, NeighborTable::State::Failed );
+      }
+      break;
+
+    // no attempts on a failed neighbor for a minute: forget it
+    case NeighborTimer::FailedExpiry:
+      if ( entry->state == NeighborTable::State::Failed and age( *entry ) > ARP_FAILED_TTL_MS ) {
+        arp_table.erase( fired.key );
+      }
+      break;
+
+    // a mapping about to expire: if it has carried traffic since it was learnt, ask the
+    // neighbor (directly) to confirm it; the reply restarts the 30 seconds
+    case NeighborTimer::Refresh:
+      if ( entry->state == NeighborTable::State::Reachable
+           and age( *entry ) >= ARP_ENTRY_TTL_MS - ARP_REFRESH_LEAD_MS
+           and ( entry->flags & NeighborTable::FLAG_USED ) ) {
+        entry->flags &= ~NeighborTable::FLAG_USED;
+        send_arp_request( fired.key, entry->ethernet_address() );
+      }
+      break;
   }
 }
 
 optional<EthernetFrame> NetworkInterface::maybe_send()
 {
-  if (!ready_to_be_sent.empty()){
-    EthernetFrame frame = ready_to_be_sent.front();
-    ready_to_be_sent.pop();
-    return frame;
+  return ready_to_be_sent.pop( timer );
+}
+
+// frames: where to move the frames, oldest first (at most frames.size() of them)
+size_t NetworkInterface::drain_frames( const span<EthernetFrame> frames )
+{
+  size_t count = 0;
+  while ( count < frames.size() ) {
+    optional<EthernetFrame> frame = ready_to_be_sent.pop( timer );
+    if ( not frame.has_value() ) {
+      break;
+    }
+    frames[count++] = move( *frame );
   }
-  return {};
+  return count;
 }
@@ -1,15 +1,23 @@
 #pragma once
 
 #include "address.hh"
+#include "egress_scheduler.hh"
 #include "ethernet_frame.hh"
 #include "ipv4_datagram.hh"
+#include "neighbor_table.hh"
+#include "seqlock_neighbor_table.hh"
+#include "timer_wheel.hh"
+#include "token_bucket.hh"
 
+#include <array>
 #include <iostream>
-#include <list>
+#include <memory>
 #include <optional>
 #include <queue>
+#include <span>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 // A "network interface" that connects IP (the internet layer, or network layer)
 // with Ethernet (the network access layer, or link layer).
@@ -34,27 +42,181 @@
 // and learns or replies as necessary.
 class NetworkInterface
 {
+public:
+  // Counters of datagrams the interface had to give up on
+  struct Statistics
+  {
+    uint64_t unreachable_drops = 0; // next hop was held down after failed ARP requests
+    uint64_t pending_drops = 0;     // waited for a next hop that never resolved, or overflowed its queue
+    uint64_t resolution_limit_drops = 0; // next hop unknown, and too many others were being resolved
+    uint64_t neighbor_evictions = 0;     // mappings evicted to make room for new ones
+    uint64_t policer_drops = 0;          // received datagrams over the ingress rate limit
+  };
+
 private:
   // Ethernet (known as hardware, network-access, or link-layer) address of the interface
-  EthernetAddress ethernet_address_;
+  MacAddress ethernet_address_;
 
   // IP (known as Internet-layer or network-layer) address of the interface
   Address ip_address_;
-  std::unordered_map<uint32_t, std::pair<EthernetAddress, size_t>> arp_table{};
-  std::unordered_map<uint32_t, size_t> arp_requests{};
-  std::queue<EthernetFrame> ready_to_be_sent {};
-  std::queue<InternetDatagram> packet_queue {};
-  std::queue<uint32_t> arp_queue {};
+
+  // How long a learned mapping stays valid, and how long to wait for an ARP reply
+  static constexpr size_t ARP_ENTRY_TTL_MS = 30000;
+  static constexpr size_t ARP_REQUEST_TIMEOUT_MS = 5000;
+
+  // Backoff for neighbors that do not answer. The first unanswered request may be retried
+  // right away; after each further one, the neighbor is held down (datagrams to it are
+  // dropped, and no requests are sent) for 5 s, doubling up to 40 s. A failed neighbor is
+  // forgotten, and its backoff reset, a minute after its last failure.
+  static constexpr size_t ARP_MAX_HOLD_DOWN_MS = 40000;
+  static constexpr size_t ARP_FAILED_TTL_MS = 60000;
+  static size_t hold_down_ms( unsigned failures );
+
+  // ARP cache: learned mappings and outstanding requests, keyed by IPv4 address
+  NeighborTable arp_table {};
+
+  // Bounds on the ARP cache, so that hostile or broken link-layer traffic cannot make it
+  // grow without limit: total mappings (beyond which cold ones are evicted, in CLOCK order),
+  // and neighbors being resolved at once (beyond which datagrams to new ones are dropped)
+  size_t max_neighbors_ = 128 * 1024;
+  size_t max_incomplete_neighbors_ = 1024;
+  size_t incomplete_neighbors_ = 0;
+
+  // Frames awaiting transmission, queued by traffic class (each queue bounded, and kept from
+  // building a standing queue by CoDel)
+  EgressScheduler ready_to_be_sent {};
+
+  // Datagrams waiting for their next hop to resolve, grouped by next-hop IP address, so that
+  // each neighbor's datagrams are sent or dropped on their own. Each group is capped; when
+  // a group is full, its oldest datagrams are dropped.
+  static constexpr size_t MAX_PENDING_DATAGRAMS = 64;
+  static constexpr size_t MAX_PENDING_BYTES = 64 * 1024;
+  struct PendingQueue
+  {
+    std::queue<InternetDatagram> datagrams {};
+    size_t bytes = 0;
+  };
+  std::unordered_map<uint32_t, PendingQueue> pending_datagrams_ {};
   size_t timer = 0;
+  Statistics statistics_ {};
+
+  // Deadlines for ARP cache entries: expiry of learned mappings and timeout of requests.
+  // Each state change schedules a timer; one that fires after a later change is ignored.
+  enum class NeighborTimer : uint32_t
+  {
+    EntryExpiry,
+    RequestTimeout,
+    Refresh,
+    FailedExpiry,
+  };
+
+  // If enabled, a mapping that has carried traffic is re-requested (by unicast ARP) this long
+  // before it expires, so that a busy neighbor never falls back to the pending path
+  static constexpr size_t ARP_REFRESH_LEAD_MS = ARP_REQUEST_TIMEOUT_MS;
+  bool refresh_neighbors_ = false;
+  TimerWheel neighbor_timers_ {};
+  std::vector<TimerWheel::Timer> expired_timers_ {};
+
+  // Milliseconds since `entry` last changed state
+  uint32_t age( const NeighborTable::Entry& entry ) const;
+
+  // Move `entry` to `state` as of now, and schedule the deadline that goes with it
+  void set_neighbor_state( NeighborTable::Entry& entry, NeighborTable::State state );
+  void change_neighbor_state( NeighborTable::Entry& entry, NeighborTable::State from, NeighborTable::State state );
+
+  // Start resolving an unresolved neighbor (`entry` is its entry, or nullptr if it has none),
+  // unless a request is already outstanding. Returns false if the neighbor is held down
+  // after failed requests.
+  bool solicit( uint32_t ip, NeighborTable::Entry* entry );
+  bool may_solicit( const NeighborTable::Entry* entry ) const;
+
+  NeighborTable::Entry& add_neighbor( uint32_t ip, NeighborTable::State state );
+  void evict_neighbor();
+  void learn_neighbor( NeighborTable::Entry& entry, MacAddress ethernet_address );
+
+  // Copy of the learned mappings for other threads to read (see share_neighbors()), if any
+  std::shared_ptr<SeqlockNeighborTable> shared_neighbors_ {};
+  void unshare_neighbor( uint32_t ip );
+
+  // Act on a fired neighbor timer, if it is still current
+  void neighbor_timer_fired( const TimerWheel::Timer& fired );
+
+  bool accepts( const EthernetHeader& header ) const;
+
+  // Ingress policing: received IPv4 datagrams must fit both the interface's token bucket
+  // and that of their traffic class (each optional), or are dropped before being parsed
+  std::optional<TokenBucket> ingress_policer_ {};
+  std::array<std::optional<TokenBucket>, EgressScheduler::CLASSES> class_policers_ {};
+  bool police( const EthernetFrame& frame );
+  void recv_arp( const EthernetFrame& frame );
+
+  // IPv4 frames of the burst being received by recv_frames(), kept between calls for its capacity
+  std::vector<const EthernetFrame*> burst_ipv4_frames_ {};
+
+  // Encapsulate a datagram in a frame to `dst` and queue it for transmission
+  void send_ipv4_frame( const InternetDatagram& dgram, MacAddress dst );
+
+  // Note that a learned mapping is carrying traffic (see set_neighbor_refresh())
+  static void mark_in_use( NeighborTable::Entry& entry );
+
+  // Per-neighbor holding area for datagrams whose next hop is unresolved
+  static size_t datagram_size( const InternetDatagram& dgram );
+  void enqueue_pending( uint32_t next_hop_ip, const InternetDatagram& dgram );
+  void flush_pending( uint32_t ip, MacAddress dst );
+  void drop_pending( uint32_t ip );
 
 public:
   // Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer)
   // addresses
-  NetworkInterface( const EthernetAddress& ethernet_address, const Address& ip_address );
+  NetworkInterface( MacAddress ethernet_address, const Address& ip_address );
 
   // Access queue of Ethernet frames awaiting transmission
   std::optional<EthernetFrame> maybe_send();
 
+  // Moves up to frames.size() frames awaiting transmission into `frames` (in the order
+  // maybe_send() would return them), and returns how many were moved
+  size_t drain_frames( std::span<EthernetFrame> frames );
+
+  // Number of frames awaiting transmission (CoDel may yet drop some of them)
+  size_t frames_ready() const { return ready_to_be_sent.size(); }
+
+  // Limits and CoDel parameters of the transmit queue for one traffic class (IPv4 datagrams
+  // are classed by DSCP, ARP messages are Control; see EgressScheduler)
+  void set_egress_queue( EgressScheduler::Class traffic_class, const CoDelQueue::Config& config )
+  {
+    ready_to_be_sent.queue( traffic_class ).set_config( config );
+  }
+
+  // Share of the link left over by the priority classes that goes to a round-robin class
+  void set_egress_weight( EgressScheduler::Class traffic_class, unsigned weight )
+  {
+    ready_to_be_sent.set_weight( traffic_class, weight );
+  }
+
+  // Limit the IPv4 datagrams received to `rate` bytes per second on average, in bursts of up to
+  // `burst` bytes; datagrams beyond that are dropped on arrival
+  void set_ingress_policer( uint64_t rate, uint64_t burst ) { ingress_policer_.emplace( rate, burst ); }
+
+  // Likewise for the datagrams of one traffic class (by DSCP, as for transmission), on top of
+  // any limit for the interface as a whole
+  void set_ingress_policer( EgressScheduler::Class traffic_class, uint64_t rate, uint64_t burst )
+  {
+    class_policers_.at( static_cast<size_t>( traffic_class ) ).emplace( rate, burst );
+  }
+
+  // Remove all ingress limits
+  void clear_ingress_policers()
+  {
+    ingress_policer_.reset();
+    class_policers_ = {};
+  }
+
+  // Frames sent and dropped, and queueing delays, of one traffic class
+  const CoDelQueue::Statistics& egress_statistics( EgressScheduler::Class traffic_class ) const
+  {
+    return ready_to_be_sent.queue( traffic_class ).statistics();
+  }
+
   // Sends an IPv4 datagram, encapsulated in an Ethernet frame (if it knows the Ethernet destination
   // address). Will need to use [ARP](\ref rfc::rfc826) to look up the Ethernet destination address
   // for the next hop.
@@ -68,11 +230,46 @@ public:
   // If type is ARP reply, learn a mapping from the "sender" fields.
   std::optional<InternetDatagram> recv_frame( const EthernetFrame& frame );
 
+  // Receives a burst of Ethernet frames, as if by recv_frame() on each, except that all the ARP
+  // messages are handled before any IPv4 datagram. The datagrams are appended to `datagrams`
+  // (in order of arrival); returns how many were appended.
+  size_t recv_frames( std::span<const EthernetFrame> frames, std::vector<InternetDatagram>& datagrams );
+
   // Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
 
-  void send_arp_request();
+  const Statistics& statistics() const { return statistics_; }
+
+  // Start resolving `next_hop` ahead of the first datagram to it (no-op if it is already
+  // known or being resolved)
+  void resolve( const Address& next_hop );
+
+  // Keep mappings in active use fresh by re-requesting them shortly before they expire
+  void set_neighbor_refresh( bool enabled ) { refresh_neighbors_ = enabled; }
+
+  // Bound the ARP cache to `max_neighbors` mappings, of which at most `max_incomplete`
+  // may be awaiting a reply (both must be at least 1)
+  void set_neighbor_limits( size_t max_neighbors, size_t max_incomplete );
+
+  // A copy of the learned mappings (about `capacity` of them) that other threads may read at
+  // any time, without locking, while this interface keeps it up to date as it learns and
+  // forgets neighbors (see SeqlockNeighborTable). Later calls return the same copy. The
+  // interface must not be copied afterwards, since the copy has room for one writer only.
+  std::shared_ptr<const SeqlockNeighborTable> share_neighbors( size_t capacity = 1024 );
+
+  // Any thread, once share_neighbors() has been called: encapsulate `dgram` in a frame to
+  // `next_hop_ip`, if the shared copy of the learned mappings resolves it (returns false,
+  // leaving `frame` alone, if it does not). Reads nothing that the interface changes, so
+  // forwarding threads can build frames while the interface's owner goes on using it.
+  bool build_frame( const InternetDatagram& dgram, uint32_t next_hop_ip, EthernetFrame& frame ) const;
+
+  // Queue a frame made by build_frame() for transmission, as send_datagram() would have
+  // (`tos` is the datagram's type of service, which selects its traffic class)
+  void send_frame( EthernetFrame&& frame, uint32_t next_hop_ip, uint8_t tos );
 
-  bool ethernet_address_equal(EthernetAddress addr1, EthernetAddress addr2);
+  // Number of mappings (learned, pending or failed) in the ARP cache
+  size_t neighbor_count() const { return arp_table.size(); }
 
+  // Sends an ARP request for `target_ip` (broadcast, unless the neighbor's address is known)
+  void send_arp_request( uint32_t target_ip, MacAddress dst = ETHERNET_BROADCAST );
 };
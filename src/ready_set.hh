@@ -0,0 +1,53 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A set of small integers (e.g. interface indices) kept as a bitmap, for finding the members
+// among many mostly-absent candidates: visiting the members costs one count-trailing-zeros
+// per member and one load per 64 candidates, however few are members.
+class ReadySet
+{
+  std::vector<uint64_t> words_ {};
+  size_t size_ {};
+
+  static constexpr size_t WORD_BITS = 64;
+
+public:
+  // Make room for members 0 .. `capacity` - 1
+  void reserve( size_t capacity ) { words_.resize( ( capacity + WORD_BITS - 1 ) / WORD_BITS ); }
+
+  void insert( size_t index )
+  {
+    uint64_t& word = words_[index / WORD_BITS];
+    const uint64_t bit = uint64_t { 1 } << ( index % WORD_BITS );
+    size_ += ( word & bit ) == 0;
+    word |= bit;
+  }
+
+  void erase( size_t index )
+  {
+    uint64_t& word = words_[index / WORD_BITS];
+    const uint64_t bit = uint64_t { 1 } << ( index % WORD_BITS );
+    size_ -= ( word & bit ) != 0;
+    word &= ~bit;
+  }
+
+  bool contains( size_t index ) const { return ( words_[index / WORD_BITS] >> ( index % WORD_BITS ) ) & 1; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Call `f( index )` for each member, in increasing order. `f` may erase the member it is
+  // given; members inserted during the walk may or may not be visited.
+  template<class F>
+  void for_each( F&& f ) const
+  {
+    for ( size_t w = 0; w < words_.size(); w++ ) {
+      for ( uint64_t bits = words_[w]; bits != 0; bits &= bits - 1 ) {
+        f( w * WORD_BITS + static_cast<size_t>( std::countr_zero( bits ) ) );
+      }
+    }
+  }
+};
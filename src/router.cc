@@ -3,6 +3,9 @@
 #include <iostream>
 #include <limits>
 #include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 
 using namespace std;
 
@@ -27,36 +30,12 @@ void Router::add_route( const uint32_t route_prefix,
   R.updateRouteNode(next_hop, route_prefix, interface_num, prefix_length);
   //add to the routing table
   routetable.push_back(R);
-}
-//This function sends the Datagram to the correct interface number outside of the network by sending to next hop.
-void Router::SendOutsideNetwork(InternetDatagram &tosend, size_t inum, int nextID) 
-{
-    //double check nhop indeed has value and it is not null before doing value()
-    //also double check tosend header ttl is not zero before sending(otherwise we would have to drop packet)
-    if(routetable[nextID].nhop.has_value()){
-        if(routetable[nextID].nhop != std::nullopt){
-            if(tosend.header.ttl != 0){
-                //get the address and make sure it is an adress type by using Address::from_ipv4_numeric
-                const optional<Address> nexthop = routetable[nextID].nhop.value();
-                Address addr = Address::from_ipv4_numeric(nexthop->ipv4_numeric());
-                interface(inum).send_datagram(tosend,addr);   
-            }
-            
-        }
-    }
-}
 
-//This function sends the Datagram to the correct interface inside the network, hence we look up the dgram dst and send it there.
-void Router::SendInsideNetwork(InternetDatagram &tosend, size_t inum) 
-{
-    //double check ttl is not zero before sending, no next hop to check here
-    if(tosend.header.ttl != 0){
-        //set address properly using the datagrams dst
-        auto addr = Address::from_ipv4_numeric(tosend.header.dst);
-        interface(inum).send_datagram(tosend, addr);
-    } 
+  //resolve the next hop now, so the first datagrams on this route don't have to wait for ARP
+  if(next_hop.has_value()){
+    interface(interface_num).resolve(next_hop.value());
+  }
 }
-
 //this function returns the mask value and considers the special cases of 0 and 32 prefix length.
 uint32_t Router::retmask(uint8_t plen){
     uint32_t mask;
@@ -93,88 +72,330 @@ bool Router::checkroute(uint32_t submask, uint32_t dst, uint32_t prefix ){
     return retval;
 }
 
-void Router::route() 
-{
-    //iterate through the interfaces
-    //count is used to iterate.
-    size_t count = 0;
-    while(count != interfaces_.size()){
-        //use maybe_receive to find out if there is a datagram in the current interface
-        std::optional<InternetDatagram> hasdgram = interfaces_[count].maybe_receive();
-        //check if empty, otherwise there is a dgram to send
-        while (hasdgram.has_value())
-            {
-            //NextID: is the index of matching prefix route
-            //longestmatch: simply keeps track of the current longest matching prefix for route
-            int nextID = -1;
-            int longestmatch = -1;
-            //check if value it has is not null
-            if(hasdgram != std::nullopt){
-                //get the dgram for this interface
-                InternetDatagram tosend = hasdgram.value();
-                //find the longest matching prefix for the dgram's dst by iterating the route table
-                //counter: is there to iterate through the routes
-                size_t counter = 0;
-                while(counter != routetable.size()){
-                    uint8_t plen = routetable[counter].prefixlen;
-                    //get the subnet mask using retmask function
-                    uint32_t submask = retmask(plen);
-                    uint32_t pfix = routetable[counter].prefix;
-                    //then we check the routes to see if the subnet masks matches 
-                    if(checkroute(submask, tosend.header.dst, pfix)){
-                        //if they match check which is greater plen or longestmatch(make sure both types are the same)
-                        int maxpfix = max(longestmatch, static_cast<int>(plen));
-                        //if plen is greater then we have a new route to keep track of
-                        if(maxpfix == static_cast<int>(plen)){
-                            //keep track of new route that we can send to(cast right types as well)
-                            longestmatch = static_cast<int>(plen);
-                            nextID = static_cast<int>(counter);
-                        }
-                        else{
-                            //go to next route if longest is greater
-                            counter++;
-                            continue;
-                        }
-                    }
-                    //move to next route
-                    counter++;
-                }
-                //all routes have been traversed and a route should have been found
-
-                //made an if to check that NextId != -1 or greater than -1 as if these starements were false then no routes found, and an if for ttl not equal to 1 and not equal to zero as anything above 1 would allow us to send and not drop packet. 
-                if(nextID != -1 || nextID > -1){
-                    if(tosend.header.ttl != 1 && tosend.header.ttl != 0){
-                        //decrease ttl since it will not go to 0
-                        tosend.header.ttl -= 1;
-                        //compute the checksum since we have modifed header by decreasing ttl(and to avoid bad datagram received)
-                        tosend.header.compute_checksum();
-                        //check if there is a next hop and it is not null, if so we have to send it outside of our network
-                        if(routetable[nextID].nhop.has_value()){
-                            if(routetable[nextID].nhop != std::nullopt){
-                                //get interface number using route table and nextID for route to send to
-                                size_t inum = routetable[nextID].interface_num;
-                                SendOutsideNetwork(tosend, inum, nextID);
-                            }
-                        }
-                        //otherwise if there is no nexthop, we have to send inside of our network(to datagrams dst)
-                        else{
-                            //get interface number using route table and nextID for route to send to
-                            size_t inum = routetable[nextID].interface_num;
-                            SendInsideNetwork(tosend, inum);
-                        } 
-                    }
-                }
-                //drop and go to next iteration/packet if no route found
-                else{
-                    hasdgram = interfaces_[count].maybe_receive();
-                    continue;
-                }
-            }
-            //otherwise drop
-            //move to next dgram for current interface
-            hasdgram = interfaces_[count].maybe_receive();
+// the longest matching prefix for `dst`, found by checking every route (a later route wins a tie)
+int Router::lookup( const uint32_t dst ) const
+{
+  int nextID = -1;
+  int longestmatch = -1;
+  for ( size_t counter = 0; counter < routetable.size(); counter++ ) {
+    const uint8_t plen = routetable[counter].prefixlen;
+    if ( checkroute( retmask( plen ), dst, routetable[counter].prefix ) and static_cast<int>( plen ) >= longestmatch ) {
+      longestmatch = static_cast<int>( plen );
+      nextID = static_cast<int>( counter );
+    }
+  }
+  return nextID;
+}
+
+void Router::set_quantum( const size_t bytes )
+{
+  if ( bytes == 0 ) {
+    throw runtime_error( "Router: quantum must be at least 1 byte" );
+  }
+  quantum_ = bytes;
+}
+
+void Router::route()
+{
+  for ( auto& interface : interfaces_ ) {
+    interface.receive_handoff();
+  }
+
+  if ( pipeline_ != nullptr ) {
+    route_pipelined();
+  } else if ( workers_ != nullptr ) {
+    // the whole backlog as one burst (its rounds in order), for the workers to share
+    burst_.clear();
+    while ( not ready_->empty() ) {
+      gather_round();
+    }
+    forward_burst();
+  } else {
+    while ( not ready_->empty() ) {
+      burst_.clear();
+      gather_round();
+      forward_burst();
+    }
+  }
+
+  for ( auto& interface : interfaces_ ) {
+    interface.transmit_handoff();
+  }
+}
+
+void Router::gather_round()
+{
+  // up to a quantum (plus unused credit) from each interface that has any datagrams; an
+  // interface leaves the ready set when it runs out
+  ready_->for_each( [&]( const size_t i ) {
+    deficits_[i] += quantum_;
+    interfaces_[i].maybe_receive_burst( burst_, deficits_[i] );
+    if ( not interfaces_[i].has_received() ) {
+      deficits_[i] = 0;
+    }
+  } );
+}
+
+void Router::set_workers( const size_t workers )
+{
+  if ( workers == 0 ) {
+    throw runtime_error( "Router: need at least one worker" );
+  }
+  workers_ = workers > 1 ? make_unique<WorkerPool>( workers ) : nullptr;
+  if ( workers_ != nullptr ) {
+    share_neighbors();
+  }
+}
+
+// Route the datagrams in burst_, and send them on
+void Router::forward_burst()
+{
+  // look up every route first (each worker taking a contiguous share, if there are workers)...
+  burst_routes_.resize( burst_.size() );
+  burst_frames_.resize( burst_.size() );
+  if ( workers_ != nullptr and burst_.size() >= MIN_PARALLEL_BURST ) {
+    const size_t share = ( burst_.size() + workers_->size() - 1 ) / workers_->size();
+    workers_->run( [this, share]( const size_t worker ) {
+      for ( size_t i = worker * share; i < min( burst_.size(), ( worker + 1 ) * share ); i++ ) {
+        prepare( burst_[i], burst_routes_[i], burst_frames_[i] );
+      }
+    } );
+  } else {
+    for ( size_t i = 0; i < burst_.size(); i++ ) {
+      prepare( burst_[i], burst_routes_[i], burst_frames_[i] );
+    }
+  }
+
+  // ...then send them on, in order of arrival
+  dispatch( burst_, burst_routes_, burst_frames_ );
+}
+
+//with no next hop, the destination is on the attached network
+uint32_t Router::next_hop( const RouteNode& route, const InternetDatagram& dgram )
+{
+  return route.nhop.has_value() ? route.nhop->ipv4_numeric() : dgram.header.dst;
+}
+
+void Router::dispatch( vector<InternetDatagram>& datagrams, const vector<int>& routes, vector<EthernetFrame>& frames )
+{
+  try {
+    // sort the datagrams (in order of arrival) by egress interface...
+    for ( size_t i = 0; i < datagrams.size(); i++ ) {
+      if ( routes[i] < 0 ) {
+        continue;
+      }
+      const RouteNode& route = routetable[routes[i]];
+      const uint32_t hop = next_hop( route, datagrams[i] );
+      egress_.at( route.interface_num ).push_back( { std::move( datagrams[i] ), hop, std::move( frames[i] ) } );
+    }
+
+    // ...and hand each interface its share in one go (ready-made frames as they are, and the
+    // rest to be resolved)
+    for ( size_t i = 0; i < egress_.size(); i++ ) {
+      for ( auto& forward : egress_[i] ) {
+        if ( not forward.frame.payload.empty() ) {
+          interfaces_[i].send_frame( std::move( forward.frame ), forward.next_hop, forward.dgram.header.tos );
+        } else {
+          interfaces_[i].send_datagram( forward.dgram, Address::from_ipv4_numeric( forward.next_hop ) );
+        }
+      }
+      egress_[i].clear();
+    }
+  } catch ( ... ) {
+    // drop whatever was not sent, rather than send it again with the next burst
+    for ( auto& forwards : egress_ ) {
+      forwards.clear();
+    }
+    throw;
+  }
+}
+
+void Router::prepare( InternetDatagram& dgram, int& route, EthernetFrame& frame ) const
+{
+  frame.payload.clear();
+  route = lookup( dgram.header.dst );
+
+  //drop if there is no route, or the TTL runs out here
+  if ( route < 0 or dgram.header.ttl <= 1 ) {
+    route = -1;
+    return;
+  }
+
+  //decrease ttl, and compute the checksum since we have modified the header
+  dgram.header.ttl -= 1;
+  dgram.header.compute_checksum();
+
+  const RouteNode& node = routetable[route];
+  interfaces_.at( node.interface_num ).build_frame( dgram, next_hop( node, dgram ), frame );
+}
+
+void Router::share_neighbors()
+{
+  for ( auto& interface : interfaces_ ) {
+    interface.share_neighbors();
+  }
+}
+
+namespace {
+
+// The stages of the pipeline only ever wait on each other briefly, within one call to
+// route(), so they spin (politely) rather than sleep
+template<class T>
+void push_spinning( SpscRing<T>& ring, T&& item )
+{
+  while ( not ring.push( std::move( item ) ) ) {
+    this_thread::yield();
+  }
+}
+
+template<class T>
+void pop_spinning( SpscRing<T>& ring, T& item )
+{
+  while ( not ring.pop( item ) ) {
+    this_thread::yield();
+  }
+}
+
+// Sleep until `counter` moves on from `seen`, and return its new value
+uint64_t wait_for_change( const atomic<uint64_t>& counter, const uint64_t seen )
+{
+  counter.wait( seen, memory_order_acquire );
+  return counter.load( memory_order_acquire );
+}
+
+} // namespace
+
+void Router::set_pipelined( const bool enabled )
+{
+  if ( not enabled ) {
+    pipeline_.reset();
+    return;
+  }
+  if ( pipeline_ != nullptr ) {
+    return;
+  }
+
+  share_neighbors();
+  pipeline_ = make_unique<Pipeline>();
+  Pipeline& pipeline = *pipeline_;
+  pipeline.lookup_thread = thread( [this, &pipeline] { lookup_stage( pipeline ); } );
+  pipeline.egress_thread = thread( [this, &pipeline] { egress_stage( pipeline ); } );
+}
+
+Router::Pipeline::~Pipeline()
+{
+  stopping.store( true );
+  started.fetch_add( 1, memory_order_release );
+  started.notify_all();
+  for ( auto* stage : { &lookup_thread, &egress_thread } ) {
+    if ( stage->joinable() ) {
+      stage->join();
+    }
+  }
+}
+
+void Router::route_pipelined()
+{
+  Pipeline& pipeline = *pipeline_;
+  const uint64_t call = pipeline.started.fetch_add( 1, memory_order_release ) + 1;
+  pipeline.started.notify_all();
+
+  // each burst goes out in a recycled one, if the egress stage has handed any back, so that
+  // burst_ takes over an empty vector with capacity to spare
+  const auto next_burst = [&] {
+    Burst burst;
+    pipeline.recycled.pop( burst );
+    burst.last = false;
+    return burst;
+  };
+  while ( not ready_->empty() ) {
+    burst_.clear();
+    gather_round();
+    Burst burst = next_burst();
+    burst.datagrams.swap( burst_ );
+    push_spinning( pipeline.gathered, std::move( burst ) );
+  }
+  Burst last = next_burst();
+  last.last = true;
+  push_spinning( pipeline.gathered, std::move( last ) );
+
+  // wait for the egress stage to get through everything
+  for ( uint64_t finished = pipeline.finished.load( memory_order_acquire ); finished != call; ) {
+    finished = wait_for_change( pipeline.finished, finished );
+  }
+
+  if ( pipeline.lookup_error ) {
+    pipeline.error = nullptr;
+    rethrow_exception( exchange( pipeline.lookup_error, nullptr ) );
+  }
+  if ( pipeline.error ) {
+    rethrow_exception( exchange( pipeline.error, nullptr ) );
+  }
+}
+
+void Router::lookup_stage( Pipeline& pipeline ) const
+{
+  uint64_t seen = 0;
+  while ( true ) {
+    seen = wait_for_change( pipeline.started, seen );
+    if ( pipeline.stopping.load() ) {
+      return;
+    }
+
+    Burst burst;
+    do {
+      pop_spinning( pipeline.gathered, burst );
+      burst.routes.resize( burst.datagrams.size() );
+      burst.frames.resize( burst.datagrams.size() );
+      for ( size_t i = 0; i < burst.datagrams.size(); i++ ) {
+        // a datagram that cannot be prepared is dropped, and the rest of the burst carries on
+        // (so that route() still sees its last burst through)
+        try {
+          prepare( burst.datagrams[i], burst.routes[i], burst.frames[i] );
+        } catch ( ... ) {
+          burst.routes[i] = -1;
+          if ( not pipeline.lookup_error ) {
+            pipeline.lookup_error = current_exception();
+          }
         }
-        //move to next interface.
-        count++;
+      }
+      const bool last = burst.last;
+      push_spinning( pipeline.routed, std::move( burst ) );
+      burst.last = last;
+    } while ( not burst.last );
+  }
+}
+
+void Router::egress_stage( Pipeline& pipeline )
+{
+  uint64_t seen = 0;
+  while ( true ) {
+    seen = wait_for_change( pipeline.started, seen );
+    if ( pipeline.stopping.load() ) {
+      return;
     }
-}
\ No newline at end of file
+
+    bool last = false;
+    do {
+      Burst burst;
+      pop_spinning( pipeline.routed, burst );
+      try {
+        dispatch( burst.datagrams, burst.routes, burst.frames );
+      } catch ( ... ) {
+        if ( not pipeline.error ) {
+          pipeline.error = current_exception();
+        }
+      }
+
+      // hand the emptied burst back (or let it go, if the ring is full)
+      last = burst.last;
+      burst.datagrams.clear();
+      burst.routes.clear();
+      burst.frames.clear();
+      pipeline.recycled.push( std::move( burst ) );
+    } while ( not last );
+
+    pipeline.finished.fetch_add( 1, memory_order_release );
+    pipeline.finished.notify_all();
+  }
+}
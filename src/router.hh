@@ -1,9 +1,18 @@
 #pragma once
 
 #include "network_interface.hh"
+#include "ready_set.hh"
+#include "spsc_ring.hh"
+#include "worker_pool.hh"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
 #include <optional>
 #include <queue>
+#include <span>
+#include <thread>
 #include <vector>
 
 // A wrapper for NetworkInterface that makes the host-side
@@ -14,6 +23,35 @@
 class AsyncNetworkInterface : public NetworkInterface
 {
   std::queue<InternetDatagram> datagrams_in_ {};
+  std::vector<InternetDatagram> burst_ {}; // scratch space for recv_frames()
+
+  // The owner's set of interfaces with datagrams waiting, and this interface's index in it:
+  // kept up to date as datagrams_in_ becomes non-empty and empty again
+  std::shared_ptr<ReadySet> ready_ {};
+  size_t ready_index_ = 0;
+
+  // Rings for exchanging frames with an I/O thread (see enable_handoff())
+  struct Handoff
+  {
+    explicit Handoff( size_t capacity ) : rx( capacity ), tx( capacity ) {}
+    SpscRing<EthernetFrame> rx; // received, from the I/O thread
+    SpscRing<EthernetFrame> tx; // to transmit, for the I/O thread
+  };
+  static constexpr size_t HANDOFF_BURST = 32;
+  std::shared_ptr<Handoff> handoff_ {}; // shared by copies of the interface, like ready_
+  std::vector<EthernetFrame> handoff_burst_ {}; // frames on their way into or out of a ring
+
+  void update_ready()
+  {
+    if ( not ready_ ) {
+      return;
+    }
+    if ( datagrams_in_.empty() ) {
+      ready_->erase( ready_index_ );
+    } else {
+      ready_->insert( ready_index_ );
+    }
+  }
 
   public:
   
@@ -34,9 +72,43 @@ class AsyncNetworkInterface : public NetworkInterface
     auto optional_dgram = NetworkInterface::recv_frame( frame );
     if ( optional_dgram.has_value() ) {
       datagrams_in_.push( std::move( optional_dgram.value() ) );
+      update_ready();
     }
   };
 
+  // Receives a burst of Ethernet frames (see NetworkInterface::recv_frames()), queueing the
+  // IPv4 datagrams among them for later retrieval
+  void recv_frames( std::span<const EthernetFrame> frames )
+  {
+    burst_.clear();
+    NetworkInterface::recv_frames( frames, burst_ );
+    for ( auto& dgram : burst_ ) {
+      datagrams_in_.push( std::move( dgram ) );
+    }
+    update_ready();
+  }
+
+  // Moves received datagrams into `burst` (oldest first) for as long as the next one fits in
+  // what is left of `budget` bytes, and deducts their sizes from it
+  void maybe_receive_burst( std::vector<InternetDatagram>& burst, size_t& budget )
+  {
+    while ( not datagrams_in_.empty() and received_size( datagrams_in_.front() ) <= budget ) {
+      budget -= received_size( datagrams_in_.front() );
+      burst.push_back( std::move( datagrams_in_.front() ) );
+      datagrams_in_.pop();
+    }
+    update_ready();
+  }
+
+  // Are there received datagrams waiting to be retrieved?
+  bool has_received() const { return not datagrams_in_.empty(); }
+
+  // Size of a datagram, as counted against a receive budget
+  static size_t received_size( const InternetDatagram& dgram )
+  {
+    return std::max<size_t>( dgram.header.len, IPv4Header::LENGTH );
+  }
+
   // Access queue of Internet datagrams that have been received
   std::optional<InternetDatagram> maybe_receive()
   {
@@ -46,8 +118,70 @@ class AsyncNetworkInterface : public NetworkInterface
 
     InternetDatagram datagram = std::move( datagrams_in_.front() );
     datagrams_in_.pop();
+    update_ready();
     return datagram;
   }
+
+  // Let an I/O thread exchange frames with this interface through a pair of lock-free rings
+  // (of at least `capacity` frames each) instead of calling recv_frame() and maybe_send()
+  // itself. The I/O thread may then call only deliver_frames() and collect_frames(), and the
+  // thread that owns the interface moves frames between the rings and the interface with
+  // receive_handoff() and transmit_handoff() (Router::route() does both).
+  void enable_handoff( size_t capacity )
+  {
+    handoff_ = std::make_shared<Handoff>( capacity );
+    handoff_burst_.reserve( HANDOFF_BURST );
+  }
+
+  // I/O thread: queue received frames, moving out as many as there is room for, and return
+  // how many that was (the caller may try again later with the rest, or drop them)
+  size_t deliver_frames( std::span<EthernetFrame> frames ) { return handoff_->rx.push_batch( frames ); }
+
+  // I/O thread: take up to frames.size() frames to transmit, and return how many were taken
+  size_t collect_frames( std::span<EthernetFrame> frames ) { return handoff_->tx.pop_batch( frames ); }
+
+  // Receive the frames delivered by the I/O thread (at most a ring's worth, so that a busy
+  // I/O thread cannot keep the caller here for ever)
+  void receive_handoff()
+  {
+    if ( not handoff_ ) {
+      return;
+    }
+    handoff_burst_.resize( HANDOFF_BURST );
+    for ( size_t received = 0; received < handoff_->rx.capacity(); ) {
+      const size_t count = handoff_->rx.pop_batch( handoff_burst_ );
+      if ( count == 0 ) {
+        break;
+      }
+      recv_frames( std::span { handoff_burst_ }.first( count ) );
+      received += count;
+    }
+  }
+
+  // Move frames awaiting transmission to the I/O thread, for as long as it has room for them
+  // (the rest stay queued here, where the egress queues manage them)
+  void transmit_handoff()
+  {
+    if ( not handoff_ ) {
+      return;
+    }
+    while ( frames_ready() > 0 ) {
+      handoff_burst_.resize( std::min( handoff_->tx.room(), HANDOFF_BURST ) );
+      const size_t count = drain_frames( handoff_burst_ );
+      if ( count == 0 ) {
+        break;
+      }
+      handoff_->tx.push_batch( std::span { handoff_burst_ }.first( count ) );
+    }
+  }
+
+  // Report whether datagrams are waiting to `ready` (as member `index`), from now on
+  void set_ready_set( std::shared_ptr<ReadySet> ready, size_t index )
+  {
+    ready_ = std::move( ready );
+    ready_index_ = index;
+    update_ready();
+  }
 };
 
 // A router that has multiple network interfaces and
@@ -76,40 +210,162 @@ class Router
   std::vector<RouteNode> routetable{};
 
 //helper functions:
-  //function to send outside of our network(if nhop has a value)
-  void SendOutsideNetwork(InternetDatagram &dgram, size_t inum, int nextID) ;
-  //function to send inside of our network(no next hop specificed)
-  void SendInsideNetwork(InternetDatagram &dgram, size_t inum);
   //a function to return the mask
-  uint32_t retmask(uint8_t plen);
+  static uint32_t retmask(uint8_t plen);
   //a function to check if the submasks of the packet and route match
-  bool checkroute(uint32_t mask, uint32_t dst, uint32_t prefix );
-  
+  static bool checkroute(uint32_t mask, uint32_t dst, uint32_t prefix );
+  // index of the longest-prefix route for `dst` (-1 if none matches)
+  int lookup( uint32_t dst ) const;
+
+  // Interfaces take turns by deficit round-robin: in each round, every interface with
+  // datagrams waiting is credited with quantum_ bytes and gives up datagrams for as long as
+  // its credit covers them. Credit left over carries to the next round, unless the interface
+  // runs out of datagrams. So a flood on one interface delays the others by at most a
+  // quantum per round, rather than for the whole of route().
+  static constexpr size_t DEFAULT_QUANTUM = 16 * 1500;
+  size_t quantum_ = DEFAULT_QUANTUM;
+  std::vector<size_t> deficits_ {};
+
+  // The interfaces with datagrams waiting (each interface keeps its own membership up to
+  // date), so that a round visits only those
+  std::shared_ptr<ReadySet> ready_ = std::make_shared<ReadySet>();
+
+  // Datagrams gathered in the current round, their routes, and those that are forwarded
+  // regrouped by egress interface (with the next hop of each)
+  struct Forward
+  {
+    InternetDatagram dgram;
+    uint32_t next_hop;
+    EthernetFrame frame; // if already built (see prepare()), else empty
+  };
+  std::vector<InternetDatagram> burst_ {};
+  std::vector<int> burst_routes_ {};
+  std::vector<EthernetFrame> burst_frames_ {};
+  std::vector<std::vector<Forward>> egress_ {};
+
+  // Add the next round's datagrams to burst_
+  void gather_round();
+  void forward_burst();
+
+  // Look up the route for a datagram and decrement its TTL, setting `route` to the route
+  // (or to -1 if the datagram is to be dropped). If the egress interface shares its learned
+  // mappings (as it does in the threaded and pipelined modes), also resolve the next hop
+  // without locking and build the frame, leaving `frame` empty if the next hop is unknown.
+  // Touches nothing else, so datagrams can be prepared on several threads at once, and
+  // while the interfaces are in use.
+  void prepare( InternetDatagram& dgram, int& route, EthernetFrame& frame ) const;
+
+  // The next hop of a datagram on a route (its destination, if the network is attached)
+  static uint32_t next_hop( const RouteNode& route, const InternetDatagram& dgram );
+
+  // Sort prepared datagrams (in order) by egress interface, and hand each interface its share
+  // (as frames, where prepare() built them)
+  void dispatch( std::vector<InternetDatagram>& datagrams,
+                 const std::vector<int>& routes,
+                 std::vector<EthernetFrame>& frames );
+
+  // Have every interface share its learned mappings, for prepare() to build frames from
+  void share_neighbors();
+
+  // Threaded mode (see set_workers()): route() gathers every round into one burst, each
+  // worker prepares a contiguous share of it, and egress stays on the calling thread, which
+  // dispatches the burst in order of arrival
+  static constexpr size_t MIN_PARALLEL_BURST = 64; // smaller backlogs aren't worth waking the workers
+  std::unique_ptr<WorkerPool> workers_ {};
+
+  // Pipelined mode (see set_pipelined()): route() gathers bursts on the calling thread and
+  // passes them through rings to a lookup stage and then an egress stage, each on a thread
+  // of its own. A burst marked `last` ends the work of one call to route().
+  struct Burst
+  {
+    std::vector<InternetDatagram> datagrams {};
+    std::vector<int> routes {};
+    std::vector<EthernetFrame> frames {};
+    bool last = false;
+  };
+  struct Pipeline
+  {
+    static constexpr size_t RING_BURSTS = 64;
+    SpscRing<Burst> gathered { RING_BURSTS };
+    SpscRing<Burst> routed { RING_BURSTS };
+    SpscRing<Burst> recycled { RING_BURSTS }; // emptied by egress, for their capacity
+    std::atomic<uint64_t> started { 0 };  // calls to route() so far (the stages wait on this)
+    std::atomic<uint64_t> finished { 0 }; // calls whose datagrams have all been handed to egress
+    std::atomic<bool> stopping { false };
+    std::exception_ptr lookup_error {}; // thrown in the lookup stage, for route() to rethrow
+    std::exception_ptr error {};        // thrown in the egress stage, likewise
+    std::thread lookup_thread {};
+    std::thread egress_thread {};
+
+    Pipeline() = default;
+    Pipeline( const Pipeline& ) = delete;
+    Pipeline& operator=( const Pipeline& ) = delete;
+    ~Pipeline();
+  };
+  void route_pipelined();
+  void lookup_stage( Pipeline& pipeline ) const;
+  void egress_stage( Pipeline& pipeline );
+
+  // last member, so that the stage threads are stopped before anything they use is destroyed
+  std::unique_ptr<Pipeline> pipeline_ {};
 
 public:
   // Add an interface to the router
   // interface: an already-constructed network interface
   // returns the index of the interface after it has been added to the router
+  // (the router keeps its interfaces' busy neighbors resolved, see set_neighbor_refresh())
   size_t add_interface( AsyncNetworkInterface&& interface )
   {
     interfaces_.push_back( std::move( interface ) );
+    interfaces_.back().set_neighbor_refresh( true );
+    deficits_.push_back( 0 );
+    egress_.emplace_back();
+    ready_->reserve( interfaces_.size() );
+    interfaces_.back().set_ready_set( ready_, interfaces_.size() - 1 );
+    if ( workers_ != nullptr or pipeline_ != nullptr ) {
+      interfaces_.back().share_neighbors();
+    }
     return interfaces_.size() - 1;
   }
 
   // Access an interface by index
   AsyncNetworkInterface& interface( size_t N ) { return interfaces_.at( N ); }
 
-  // Add a route (a forwarding rule)
+  // Add a route (a forwarding rule), and start resolving its next hop (if any)
   void add_route( uint32_t route_prefix,
                   uint8_t prefix_length,
                   std::optional<Address> next_hop,
                   size_t interface_num );
 
-  // Route packets between the interfaces. For each interface, use the
-  // maybe_receive() method to consume every incoming datagram and
-  // send it on one of interfaces to the correct next hop. The router
+  // Route packets between the interfaces. Consumes every incoming datagram and
+  // sends it on one of interfaces to the correct next hop. The router
   // chooses the outbound interface and next-hop as specified by the
   // route with the longest prefix_length that matches the datagram's
-  // destination address.
+  // destination address. Interfaces are served in rounds, a quantum at a time
+  // (see set_quantum()). Frames delivered by I/O threads are received first, and
+  // frames to transmit are handed back to them last (see
+  // AsyncNetworkInterface::enable_handoff()).
   void route();
+
+  // Set how many bytes of datagrams each interface may hand the router per round of route()
+  // (at least 1; smaller than a datagram just means that datagram waits for a later round)
+  void set_quantum( size_t bytes );
+
+  // Spread the per-datagram work of route() (route lookup, TTL and checksum) over `workers`
+  // threads, the caller's included (1, the default, does everything on the caller's thread).
+  // The datagrams of all the rounds of a call are taken at once, split into contiguous
+  // shares, one per worker, and sent on in their original order once all are done, so every
+  // flow stays in order. The routing table is shared,
+  // read-only, by all workers; routes must not be added while route() runs. Workers also
+  // build the frames of datagrams to known next hops, reading each interface's shared copy
+  // of its learned mappings (see NetworkInterface::share_neighbors()).
+  void set_workers( size_t workers );
+
+  // Run route() as a pipeline instead: the calling thread gathers datagrams from the
+  // interfaces, one thread looks up their routes and rewrites their headers, and another
+  // hands them to the egress interfaces, with bursts passed between the stages through
+  // lock-free rings. The lookup stage also builds the frames of datagrams to known next hops
+  // (as workers do, see set_workers()), leaving only ARP resolution for the rest to egress. route() still returns once every
+  // datagram has been handed over. The router must not be moved while pipelined.
+  void set_pipelined( bool enabled );
 };
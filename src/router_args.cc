@@ -0,0 +1,73 @@
+#include "router_args.hh"
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+vector<string> split( const string& str, const char separator )
+{
+  vector<string> fields;
+  stringstream stream { str };
+  for ( string field; getline( stream, field, separator ); ) {
+    fields.push_back( field );
+  }
+  return fields;
+}
+
+EthernetAddress random_private_ethernet_address()
+{
+  random_device rd;
+  EthernetAddress address;
+  for ( auto& byte : address ) {
+    byte = static_cast<uint8_t>( rd() );
+  }
+  address.at( 0 ) = 0x02; // locally administered unicast
+  return address;
+}
+
+bool parse_router_args( const span<char*> args,
+                        Router& router,
+                        RouterOptions& options,
+                        const function<bool( const string&, const vector<string>& )>& handle,
+                        const initializer_list<string_view> flags )
+{
+  for ( size_t i = 0; i < args.size(); i++ ) {
+    const string option { args[i] };
+    if ( find( flags.begin(), flags.end(), option ) != flags.end() ) {
+      if ( not handle( option, {} ) ) {
+        return false;
+      }
+      continue;
+    }
+    if ( i + 1 >= args.size() ) {
+      return false;
+    }
+    const vector<string> fields = split( args[++i], ',' );
+
+    if ( option == "--polling" and fields.size() == 1 ) {
+      options.polling_us = stoull( fields[0] );
+    } else if ( option == "--route" and fields.size() == 3 ) {
+      const vector<string> prefix = split( fields[0], '/' );
+      if ( prefix.size() != 2 ) {
+        return false;
+      }
+      router.add_route( Address { prefix[0] }.ipv4_numeric(),
+                        static_cast<uint8_t>( stoul( prefix[1] ) ),
+                        fields[1] == "-" ? optional<Address> {} : Address { fields[1] },
+                        stoul( fields[2] ) );
+    } else if ( not handle( option, fields ) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void print_router_args_usage( ostream& out )
+{
+  out << "\tInterfaces are numbered from 0 in order, and a route's INTERFACE must come before it.\n";
+  out << "\tA NEXT_HOP of - means a directly attached network. --polling keeps polling for\n";
+  out << "\tinput without sleeping until none has arrived for that long (50000 by default, 0 never\n";
+  out << "\tpolls).\n";
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "router.hh"
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Command-line handling shared by the router programs (tap_router and udp_router)
+
+// Options that every router program takes
+struct RouterOptions
+{
+  uint64_t polling_us = 50000; // --polling: see EventLoop::set_polling() (0 never polls)
+};
+
+// Split `str` into the fields between occurrences of `separator`
+std::vector<std::string> split( const std::string& str, char separator );
+
+// A random, locally administered unicast Ethernet address
+EthernetAddress random_private_ethernet_address();
+
+// Parse the arguments after the program name, in order. The common options are handled here:
+// --route PREFIX/LENGTH,NEXT_HOP,INTERFACE adds a route to `router` (so its interface must
+// come first), and --polling MICROSECONDS sets options.polling_us. Every other option goes to
+// `handle`, with its argument split at commas (or no fields, if it is one of `flags`, which
+// take no argument), and `handle` returns whether it is valid. Returns false if any option is
+// unknown or malformed (the caller then prints its usage).
+bool parse_router_args( std::span<char*> args,
+                        Router& router,
+                        RouterOptions& options,
+                        const std::function<bool( const std::string&, const std::vector<std::string>& )>& handle,
+                        std::initializer_list<std::string_view> flags = {} );
+
+// Describe the common options (for a program's usage message)
+void print_router_args_usage( std::ostream& out );
@@ -0,0 +1,102 @@
+#include "seqlock_neighbor_table.hh"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+using namespace std;
+
+SeqlockNeighborTable::SeqlockNeighborTable( const size_t capacity )
+  : buckets_( bit_ceil( max<size_t>( capacity / WAYS, 2 ) ) ), shift_( 64 - countr_zero( buckets_.size() ) )
+{}
+
+// Fibonacci hashing, as in NeighborTable
+size_t SeqlockNeighborTable::home( const uint32_t ip ) const
+{
+  constexpr uint64_t golden_ratio = 0x9e3779b97f4a7c15;
+  return static_cast<size_t>( ( ip * golden_ratio ) >> shift_ );
+}
+
+optional<MacAddress> SeqlockNeighborTable::find( const uint32_t ip ) const
+{
+  const Bucket& b = bucket( ip );
+  while ( true ) {
+    const uint32_t before = b.sequence.load( memory_order_acquire );
+    if ( before & 1 ) {
+      continue; // the writer is in the middle of changing the bucket
+    }
+
+    optional<MacAddress> found;
+    for ( size_t way = 0; way < WAYS; way++ ) {
+      if ( b.ips[way].load( memory_order_relaxed ) == ip ) {
+        found = MacAddress::from_integer( b.macs[way].load( memory_order_relaxed ) );
+        break;
+      }
+    }
+
+    // the copy is good if the writer did not touch the bucket while it was made
+    atomic_thread_fence( memory_order_acquire );
+    if ( b.sequence.load( memory_order_relaxed ) == before ) {
+      return found;
+    }
+  }
+}
+
+void SeqlockNeighborTable::begin_write( Bucket& bucket )
+{
+  bucket.sequence.store( bucket.sequence.load( memory_order_relaxed ) + 1, memory_order_relaxed );
+  atomic_thread_fence( memory_order_release );
+}
+
+void SeqlockNeighborTable::end_write( Bucket& bucket )
+{
+  bucket.sequence.store( bucket.sequence.load( memory_order_relaxed ) + 1, memory_order_release );
+}
+
+void SeqlockNeighborTable::store( const uint32_t ip, const MacAddress ethernet_address )
+{
+  if ( ip == 0 ) {
+    throw runtime_error( "SeqlockNeighborTable: 0.0.0.0 cannot be stored" );
+  }
+
+  Bucket& b = bucket( ip );
+
+  // the way that already has `ip`, else a free one, else the next victim
+  size_t way = WAYS;
+  for ( size_t i = 0; i < WAYS; i++ ) {
+    const uint32_t current = b.ips[i].load( memory_order_relaxed );
+    if ( current == ip ) {
+      way = i;
+      break;
+    }
+    if ( current == 0 and way == WAYS ) {
+      way = i;
+    }
+  }
+  if ( way == WAYS ) {
+    way = next_victim_++ % WAYS;
+  }
+
+  if ( b.ips[way].load( memory_order_relaxed ) == ip
+       and b.macs[way].load( memory_order_relaxed ) == ethernet_address.value() ) {
+    return; // nothing changes, so spare the readers a retry
+  }
+
+  begin_write( b );
+  b.ips[way].store( ip, memory_order_relaxed );
+  b.macs[way].store( ethernet_address.value(), memory_order_relaxed );
+  end_write( b );
+}
+
+void SeqlockNeighborTable::erase( const uint32_t ip )
+{
+  Bucket& b = bucket( ip );
+  for ( size_t way = 0; way < WAYS; way++ ) {
+    if ( b.ips[way].load( memory_order_relaxed ) == ip ) {
+      begin_write( b );
+      b.ips[way].store( 0, memory_order_relaxed );
+      end_write( b );
+      return;
+    }
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ethernet_header.hh"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// A neighbor table (IPv4 address to Ethernet address) for one writer and any number of
+// concurrent readers, such as forwarding threads resolving next hops while the interface
+// that owns the table goes on learning and expiring mappings.
+//
+// The table is a fixed array of buckets, each one cache line holding four mappings and a
+// sequence number (a seqlock). The writer makes the sequence number odd while it changes a
+// bucket and even again afterwards; a reader copies what it needs from the bucket and tries
+// again if the sequence number was odd or has changed. Lookups therefore take no locks and
+// make no atomic read-modify-write operations, and a reader never delays the writer.
+//
+// The table is a cache of the owner's authoritative one: when a bucket is full, storing a
+// new mapping replaces one of the others, and lookups of replaced mappings simply miss.
+class SeqlockNeighborTable
+{
+public:
+  static constexpr size_t WAYS = 4;
+
+  // Construct a table with room for about `capacity` mappings
+  explicit SeqlockNeighborTable( size_t capacity = 1024 );
+
+  // Any thread: the Ethernet address of `ip`, if the table has it
+  std::optional<MacAddress> find( uint32_t ip ) const;
+
+  // Writer only: map `ip` (which must not be 0) to `ethernet_address`
+  void store( uint32_t ip, MacAddress ethernet_address );
+
+  // Writer only: remove the mapping for `ip`, if there is one
+  void erase( uint32_t ip );
+
+  size_t capacity() const { return buckets_.size() * WAYS; }
+
+private:
+  // The mappings are atomics only so that reading one while it is being written is not a data
+  // race; relaxed loads and stores cost the same as plain ones. An ip of 0 marks a free way.
+  struct alignas( 64 ) Bucket
+  {
+    std::atomic<uint32_t> sequence { 0 };
+    std::array<std::atomic<uint32_t>, WAYS> ips {};
+    std::array<std::atomic<uint64_t>, WAYS> macs {};
+  };
+  static_assert( sizeof( Bucket ) == 64 );
+
+  std::vector<Bucket> buckets_;
+  int shift_;
+  size_t next_victim_ = 0; // way to replace when a bucket is full (round robin)
+
+  Bucket& bucket( uint32_t ip ) { return buckets_[home( ip )]; }
+  const Bucket& bucket( uint32_t ip ) const { return buckets_[home( ip )]; }
+  size_t home( uint32_t ip ) const;
+
+  // Bracket the writer's changes to a bucket
+  static void begin_write( Bucket& bucket );
+  static void end_write( Bucket& bucket );
+};
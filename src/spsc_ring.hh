@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <span>
+#include <utility>
+#include <vector>
+
+// A bounded, lock-free queue between exactly one producer thread and one consumer thread.
+//
+// The producer only writes tail_ and the consumer only writes head_; each reads the other's
+// index with acquire ordering, and only when its cached copy says the ring is full (or
+// empty), so in the common case neither touches the other's cache line. The two sides'
+// fields are on separate cache lines for the same reason.
+template<class T>
+class SpscRing
+{
+public:
+  // Room for at least `capacity` items (rounded up to a power of two)
+  explicit SpscRing( size_t capacity ) : slots_( std::bit_ceil( std::max<size_t>( capacity, 2 ) ) ), mask_( slots_.size() - 1 ) {}
+
+  SpscRing( const SpscRing& ) = delete;
+  SpscRing& operator=( const SpscRing& ) = delete;
+
+  // Producer: add an item, unless the ring is full (returns whether it was added)
+  bool push( T&& item )
+  {
+    const size_t tail = producer_.tail.load( std::memory_order_relaxed );
+    if ( tail - producer_.cached_head == slots_.size() ) {
+      producer_.cached_head = consumer_.head.load( std::memory_order_acquire );
+      if ( tail - producer_.cached_head == slots_.size() ) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move( item );
+    producer_.tail.store( tail + 1, std::memory_order_release );
+    return true;
+  }
+
+  // Consumer: take the oldest item, unless the ring is empty (returns whether one was taken)
+  bool pop( T& item )
+  {
+    const size_t head = consumer_.head.load( std::memory_order_relaxed );
+    if ( head == consumer_.cached_tail ) {
+      consumer_.cached_tail = producer_.tail.load( std::memory_order_acquire );
+      if ( head == consumer_.cached_tail ) {
+        return false;
+      }
+    }
+    item = std::move( slots_[head & mask_] );
+    consumer_.head.store( head + 1, std::memory_order_release );
+    return true;
+  }
+
+  // Producer: move as many items from the front of `items` as there is room for (with a
+  // single update of the shared index), and return how many were moved
+  size_t push_batch( std::span<T> items )
+  {
+    const size_t tail = producer_.tail.load( std::memory_order_relaxed );
+    if ( slots_.size() - ( tail - producer_.cached_head ) < items.size() ) {
+      producer_.cached_head = consumer_.head.load( std::memory_order_acquire );
+    }
+    const size_t count = std::min( items.size(), slots_.size() - ( tail - producer_.cached_head ) );
+    for ( size_t i = 0; i < count; i++ ) {
+      slots_[( tail + i ) & mask_] = std::move( items[i] );
+    }
+    producer_.tail.store( tail + count, std::memory_order_release );
+    return count;
+  }
+
+  // Consumer: move up to items.size() of the oldest items into `items` (with a single update
+  // of the shared index), and return how many were moved
+  size_t pop_batch( std::span<T> items )
+  {
+    const size_t head = consumer_.head.load( std::memory_order_relaxed );
+    if ( consumer_.cached_tail - head < items.size() ) {
+      consumer_.cached_tail = producer_.tail.load( std::memory_order_acquire );
+    }
+    const size_t count = std::min( items.size(), consumer_.cached_tail - head );
+    for ( size_t i = 0; i < count; i++ ) {
+      items[i] = std::move( slots_[( head + i ) & mask_] );
+    }
+    consumer_.head.store( head + count, std::memory_order_release );
+    return count;
+  }
+
+  // Producer: how many items push_batch() would accept right now (at least; the consumer may
+  // make more room at any time)
+  size_t room()
+  {
+    producer_.cached_head = consumer_.head.load( std::memory_order_acquire );
+    return slots_.size() - ( producer_.tail.load( std::memory_order_relaxed ) - producer_.cached_head );
+  }
+
+  size_t capacity() const { return slots_.size(); }
+
+private:
+  static constexpr size_t CACHE_LINE = 64;
+
+  struct alignas( CACHE_LINE ) Producer
+  {
+    std::atomic<size_t> tail { 0 }; // index of the next slot to fill
+    size_t cached_head = 0;         // the consumer's head, as last seen
+  };
+
+  struct alignas( CACHE_LINE ) Consumer
+  {
+    std::atomic<size_t> head { 0 }; // index of the next slot to empty
+    size_t cached_tail = 0;         // the producer's tail, as last seen
+  };
+
+  Producer producer_ {};
+  Consumer consumer_ {};
+  std::vector<T> slots_;
+  size_t mask_;
+};
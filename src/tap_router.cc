@@ -0,0 +1,123 @@
+#include "event_loop.hh"
+#include "router.hh"
+#include "router_args.hh"
+#include "tap_device.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t TICK_MS = 10;
+constexpr size_t BATCH = 32;
+
+void usage( const char* name )
+{
+  cerr << "Usage: " << name
+       << " [--interface DEVICE,IP]... [--route PREFIX/LENGTH,NEXT_HOP,INTERFACE]..."
+          " [--polling MICROSECONDS] [--stats]\n";
+  cerr << "\tEach interface is a TAP device (created if need be, and brought up), whose other end\n";
+  cerr << "\tis the kernel; move it into a network namespace to route between namespaces.\n";
+  print_router_args_usage( cerr );
+  cerr << "\t--stats prints the number of frames moved each second. Needs CAP_NET_ADMIN.\n";
+  cerr << "\tExample: " << name << " --interface tap0,10.0.0.1 --interface tap1,10.1.0.1 \\\n";
+  cerr << "\t           --route 10.0.0.0/16,-,0 --route 10.1.0.0/16,-,1\n";
+}
+
+} // namespace
+
+// Forward between TAP devices until killed, sleeping when there is nothing to do
+int main( int argc, char* argv[] )
+{
+  try {
+    if ( argc <= 0 ) {
+      abort(); // For sticklers: don't try to access argv[0] if argc <= 0.
+    }
+    auto args = span( argv, argc );
+
+    Router router;
+    RouterOptions options;
+    vector<unique_ptr<TapDevice>> devices;
+    bool stats = false;
+    const bool parsed = parse_router_args(
+      args.subspan( 1 ),
+      router,
+      options,
+      [&]( const string& option, const vector<string>& fields ) {
+        if ( option == "--stats" ) {
+          stats = true;
+        } else if ( option == "--interface" and fields.size() == 2 ) {
+          router.add_interface( { random_private_ethernet_address(), Address { fields[1] } } );
+          devices.push_back( make_unique<TapDevice>( fields[0] ) );
+          devices.back()->set_up();
+        } else {
+          return false;
+        }
+        return true;
+      },
+      { "--stats" } );
+    if ( not parsed or devices.empty() ) {
+      usage( args.front() );
+      return EXIT_FAILURE;
+    }
+
+    uint64_t frames_in = 0;
+    uint64_t frames_out = 0;
+    vector<EthernetFrame> frames;
+
+    // write whatever the interfaces have ready (frames the device has no room for are dropped)
+    const auto flush = [&] {
+      frames.resize( BATCH );
+      for ( size_t i = 0; i < devices.size(); i++ ) {
+        while ( const size_t count = router.interface( i ).drain_frames( frames ) ) {
+          frames_out += devices[i]->write_frames( span { frames }.first( count ) );
+        }
+      }
+    };
+
+    EventLoop loop;
+    for ( size_t i = 0; i < devices.size(); i++ ) {
+      loop.add( *devices[i], [&, i] {
+        frames.clear();
+        while ( devices[i]->read_frames( frames, BATCH ) > 0 ) {
+          frames_in += frames.size();
+          router.interface( i ).recv_frames( frames );
+          frames.clear();
+        }
+      } );
+    }
+    loop.after_reads( [&] {
+      router.route();
+      flush();
+    } );
+    loop.add_ticker( TICK_MS, [&]( const uint64_t ms ) {
+      for ( size_t i = 0; i < devices.size(); i++ ) {
+        router.interface( i ).tick( ms );
+      }
+      flush();
+    } );
+    if ( stats ) {
+      loop.add_ticker( 1000, [&]( const uint64_t ms ) {
+        if ( frames_in > 0 or frames_out > 0 ) {
+          cerr << "frames in: " << frames_in * 1000 / max<uint64_t>( ms, 1 ) << "/s, out: " << frames_out * 1000 / max<uint64_t>( ms, 1 ) << "/s\n";
+        }
+        frames_in = 0;
+        frames_out = 0;
+      } );
+    }
+    loop.set_polling( options.polling_us );
+    loop.run();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+#include "timer_wheel.hh"
+
+#include <bit>
+
+using namespace std;
+
+void TimerWheel::schedule( const uint64_t expiry, const uint32_t key, const uint32_t tag )
+{
+  ++size_;
+  place( { expiry, key, tag } );
+}
+
+void TimerWheel::place( const Timer& timer )
+{
+  if ( timer.expiry <= now_ ) {
+    due_.push_back( timer );
+    return;
+  }
+
+  // lowest level at which the timer's slot is less than one full turn away
+  size_t level = 0;
+  uint64_t slot = timer.expiry;
+  while ( level + 1 < LEVELS and slot - ( now_ >> ( level * SLOT_BITS ) ) >= SLOTS ) {
+    ++level;
+    slot = timer.expiry >> ( level * SLOT_BITS );
+  }
+
+  // beyond the range of the top level: park it in the furthest slot, to be re-filed later
+  const uint64_t current = now_ >> ( level * SLOT_BITS );
+  if ( slot - current >= SLOTS ) {
+    slot = current + SLOTS - 1;
+  }
+
+  const size_t index = slot & ( SLOTS - 1 );
+  slots_[level][index].push_back( timer );
+  occupied_[level] |= uint64_t { 1 } << index;
+}
+
+bool TimerWheel::next_event( uint64_t& when ) const
+{
+  bool found = false;
+  for ( size_t level = 0; level < LEVELS; level++ ) {
+    const unsigned shift = level * SLOT_BITS;
+    const uint64_t current = now_ >> shift;
+
+    // slots are ordered by distance from the current one; the current slot itself was
+    // already handled when the wheel arrived at it
+    const uint64_t ahead = rotr( occupied_[level], static_cast<int>( current & ( SLOTS - 1 ) ) ) & ~uint64_t { 1 };
+    if ( ahead == 0 ) {
+      continue;
+    }
+
+    const uint64_t candidate = ( current + countr_zero( ahead ) ) << shift;
+    if ( not found or candidate < when ) {
+      when = candidate;
+      found = true;
+    }
+  }
+  return found;
+}
+
+void TimerWheel::cascade( const size_t level, vector<Timer>& expired )
+{
+  const size_t index = ( now_ >> ( level * SLOT_BITS ) ) & ( SLOTS - 1 );
+  Slot timers = move( slots_[level][index] );
+  slots_[level][index].clear();
+  occupied_[level] &= ~( uint64_t { 1 } << index );
+
+  for ( const auto& timer : timers ) {
+    if ( timer.expiry <= now_ ) {
+      expired.push_back( timer );
+      --size_;
+    } else {
+      place( timer );
+    }
+  }
+}
+
+void TimerWheel::advance( const uint64_t now, vector<Timer>& expired )
+{
+  size_ -= due_.size();
+  expired.insert( expired.end(), due_.begin(), due_.end() );
+  due_.clear();
+
+  uint64_t when = 0;
+  while ( next_event( when ) and when <= now ) {
+    now_ = when;
+
+    // higher levels first, so that a timer can drop through several levels at once
+    for ( size_t level = LEVELS - 1; level > 0; level-- ) {
+      const uint64_t mask = ( uint64_t { 1 } << ( level * SLOT_BITS ) ) - 1;
+      if ( ( now_ & mask ) == 0 ) {
+        cascade( level, expired );
+      }
+    }
+    cascade( 0, expired );
+  }
+
+  now_ = max( now_, now );
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A hierarchical timing wheel with millisecond resolution.
+//
+// Level 0 has 64 one-millisecond slots, and each higher level has 64 slots, each as wide
+// as a full turn of the level below (64 ms, ~4 s, ~4.5 min, ~4.8 h). A timer is filed in
+// the lowest level whose range covers it, and moves down a level each time the wheel
+// reaches its slot. A per-level occupancy bitmap lets advance() jump straight to the next
+// non-empty slot, so the cost of advancing is proportional to the number of timers that
+// fire or move, not to the number of milliseconds that pass or the number pending.
+//
+// Timers cannot be cancelled. Owners are expected to check, when a timer fires, whether
+// the event it stands for is still due (and ignore it otherwise).
+class TimerWheel
+{
+public:
+  struct Timer
+  {
+    uint64_t expiry; // time (ms) at which the timer fires
+    uint32_t key;    // owner-defined, e.g. the IPv4 address the timer is about
+    uint32_t tag;    // owner-defined, e.g. what kind of event this is
+  };
+
+  explicit TimerWheel( uint64_t now = 0 ) : now_( now ) {}
+
+  // Arrange for a timer to fire once the wheel reaches `expiry` (or on the next advance()
+  // if `expiry` is not in the future)
+  void schedule( uint64_t expiry, uint32_t key, uint32_t tag );
+
+  // Move the wheel forward to `now`, appending every timer that fires to `expired`
+  // (in order of expiry, except that timers due at the same millisecond are unordered)
+  void advance( uint64_t now, std::vector<Timer>& expired );
+
+  uint64_t now() const { return now_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+private:
+  static constexpr unsigned SLOT_BITS = 6;
+  static constexpr size_t SLOTS = 1 << SLOT_BITS;
+  static constexpr size_t LEVELS = 5;
+
+  using Slot = std::vector<Timer>;
+
+  std::array<std::array<Slot, SLOTS>, LEVELS> slots_ {};
+  std::array<uint64_t, LEVELS> occupied_ {}; // bit i set iff slots_[level][i] is non-empty
+  std::vector<Timer> due_ {};                // scheduled for a time that has already passed
+  uint64_t now_;
+  size_t size_ {};
+
+  // File a timer (already counted in size_) in the right slot for the current time
+  void place( const Timer& timer );
+
+  // Earliest time at which a slot needs attention (fires or cascades), if any
+  bool next_event( uint64_t& when ) const;
+
+  // Redistribute the timers in the current slot of `level` to lower levels
+  void cascade( size_t level, std::vector<Timer>& expired );
+};
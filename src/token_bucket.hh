@@ -0,0 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// A token bucket: admits traffic at up to `rate` bytes per second on average, with bursts of
+// up to `burst` bytes. Tokens are kept in thousandths of a byte, so that refilling a few
+// milliseconds at a time at a low rate loses nothing to rounding.
+class TokenBucket
+{
+  uint64_t rate_;     // bytes per second (= thousandths of a byte per millisecond)
+  uint64_t capacity_; // burst, in thousandths of a byte
+  uint64_t tokens_;   // in thousandths of a byte
+
+public:
+  // The bucket starts full
+  TokenBucket( uint64_t rate, uint64_t burst ) : rate_( rate ), capacity_( burst * 1000 ), tokens_( capacity_ ) {}
+
+  // Add the tokens earned in `ms` milliseconds
+  void refill( uint64_t ms ) { tokens_ = std::min( capacity_, tokens_ + ms * rate_ ); }
+
+  // Are there tokens for `bytes`?
+  bool conforms( uint64_t bytes ) const { return bytes * 1000 <= tokens_; }
+
+  // Spend the tokens for `bytes` (which must conform)
+  void consume( uint64_t bytes ) { tokens_ -= bytes * 1000; }
+};
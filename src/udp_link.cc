@@ -0,0 +1,81 @@
+#include "udp_link.hh"
+
+#include <algorithm>
+
+using namespace std;
+
+UdpLink::UdpLink( const Address& local, const Address& peer ) : socket_(), peer_( peer ), buffers_( BATCH )
+{
+  socket_.bind( local );
+  socket_.set_blocking( false );
+}
+
+size_t UdpLink::send_frames( span<const EthernetFrame> frames )
+{
+  size_t sent = 0;
+  while ( sent < frames.size() ) {
+    // each frame, flattened into a buffer of its own
+    const size_t count = min( BATCH, frames.size() - sent );
+    outgoing_.clear();
+    for ( size_t i = 0; i < count; i++ ) {
+      string& buffer = buffers_[i];
+      buffer.clear();
+      for ( const auto& piece : serialize( frames[sent + i] ) ) {
+        buffer.append( static_cast<string_view>( piece ) );
+      }
+      outgoing_.emplace_back( peer_, buffer );
+    }
+
+    const size_t batch_sent = socket_.send_batch( outgoing_ );
+    sent += batch_sent;
+    if ( batch_sent < count ) {
+      break;
+    }
+  }
+  return sent;
+}
+
+size_t UdpLink::recv_frames( vector<EthernetFrame>& frames, const size_t max )
+{
+  size_t appended = 0;
+  while ( appended < max ) {
+    const size_t wanted = min( BATCH, max - appended );
+    const size_t count = socket_.recv_batch( span { buffers_ }.first( wanted ), sources_ );
+    for ( size_t i = 0; i < count; i++ ) {
+      if ( sources_[i] != peer_ ) {
+        continue;
+      }
+      // parse from an exact-size copy, so that the buffer keeps its capacity for the next batch
+      EthernetFrame frame;
+      if ( parse( frame, { string { buffers_[i] } } ) ) {
+        frames.push_back( move( frame ) );
+        ++appended;
+      }
+    }
+    if ( count < wanted ) {
+      break; // nothing more has arrived
+    }
+  }
+  return appended;
+}
+
+void UdpLink::receive( AsyncNetworkInterface& interface )
+{
+  frames_.clear();
+  recv_frames( frames_, SIZE_MAX );
+  interface.recv_frames( frames_ );
+}
+
+void UdpLink::transmit( AsyncNetworkInterface& interface )
+{
+  frames_.resize( BATCH );
+  while ( const size_t count = interface.drain_frames( frames_ ) ) {
+    send_frames( span { frames_ }.first( count ) );
+  }
+}
+
+void UdpLink::exchange( AsyncNetworkInterface& interface )
+{
+  receive( interface );
+  transmit( interface );
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ethernet_frame.hh"
+#include "router.hh"
+#include "socket.hh"
+
+#include <span>
+#include <string>
+#include <vector>
+
+// One end of a point-to-point Ethernet link carried over UDP: each frame travels, serialized,
+// as one datagram to the UDP address of the other end. Connecting interfaces through such
+// links (e.g. on localhost) lets each router or host of a topology run in a process, or on a
+// core, of its own.
+//
+// The socket is non-blocking, and frames move in batches of datagrams (see
+// DatagramSocket::recv_batch() and send_batch()).
+class UdpLink
+{
+public:
+  // Bind to `local`; frames will go to (and only be accepted from) `peer`
+  UdpLink( const Address& local, const Address& peer );
+
+  // The socket, e.g. for an EventLoop to watch (or to tune, e.g. with set_busy_poll())
+  UDPSocket& socket() { return socket_; }
+  const UDPSocket& socket() const { return socket_; }
+  Address local_address() const { return socket_.local_address(); }
+
+  // Send frames to the peer, and return how many were sent (fewer only if the socket is full;
+  // like a congested link, exchange() then drops the rest)
+  size_t send_frames( std::span<const EthernetFrame> frames );
+
+  // Append up to `max` frames from the peer (as many as have arrived) to `frames`, and return
+  // how many were appended. Datagrams from elsewhere, and ones that do not parse, are dropped.
+  size_t recv_frames( std::vector<EthernetFrame>& frames, size_t max );
+
+  // Hand everything received to `interface`
+  void receive( AsyncNetworkInterface& interface );
+
+  // Send everything `interface` has ready
+  void transmit( AsyncNetworkInterface& interface );
+
+  // Both of the above
+  void exchange( AsyncNetworkInterface& interface );
+
+  static constexpr size_t BATCH = 32;
+
+private:
+  UDPSocket socket_;
+  Address peer_;
+
+  // reused for each batch, for their capacity
+  std::vector<std::string> buffers_;
+  std::vector<Address> sources_ {};
+  std::vector<EthernetFrame> frames_ {};
+  std::vector<std::pair<Address, std::string_view>> outgoing_ {};
+};
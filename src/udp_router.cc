@@ -0,0 +1,98 @@
+#include "event_loop.hh"
+#include "router.hh"
+#include "router_args.hh"
+#include "udp_link.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+constexpr uint64_t TICK_MS = 10;
+
+void usage( const char* name )
+{
+  cerr << "Usage: " << name
+       << " [--interface IP,LOCAL_PORT,PEER_PORT]... [--route PREFIX/LENGTH,NEXT_HOP,INTERFACE]..."
+          " [--polling MICROSECONDS] [--busy-poll MICROSECONDS]\n";
+  cerr << "\tEach interface is one end of an Ethernet-over-UDP link on localhost.\n";
+  print_router_args_usage( cerr );
+  cerr << "\t--busy-poll sets SO_BUSY_POLL on every link's socket (off by default).\n";
+  cerr << "\tExample: " << name << " --interface 10.0.0.1,5000,5001 --interface 10.1.0.1,5002,5003 \\\n";
+  cerr << "\t           --route 10.0.0.0/8,-,0 --route 10.1.0.0/16,-,1\n";
+}
+
+} // namespace
+
+// Forward between Ethernet-over-UDP links until killed, sleeping when there is nothing to do
+int main( int argc, char* argv[] )
+{
+  try {
+    if ( argc <= 0 ) {
+      abort(); // For sticklers: don't try to access argv[0] if argc <= 0.
+    }
+    auto args = span( argv, argc );
+
+    Router router;
+    RouterOptions options;
+    vector<unique_ptr<UdpLink>> links;
+    unsigned busy_poll_us = 0;
+    const bool parsed
+      = parse_router_args( args.subspan( 1 ), router, options, [&]( const string& option, const vector<string>& fields ) {
+          if ( option == "--busy-poll" and fields.size() == 1 ) {
+            busy_poll_us = static_cast<unsigned>( stoul( fields[0] ) );
+          } else if ( option == "--interface" and fields.size() == 3 ) {
+            router.add_interface( { random_private_ethernet_address(), Address { fields[0] } } );
+            links.push_back( make_unique<UdpLink>( Address { "127.0.0.1", static_cast<uint16_t>( stoul( fields[1] ) ) },
+                                                   Address { "127.0.0.1", static_cast<uint16_t>( stoul( fields[2] ) ) } ) );
+          } else {
+            return false;
+          }
+          return true;
+        } );
+    if ( not parsed or links.empty() ) {
+      usage( args.front() );
+      return EXIT_FAILURE;
+    }
+    if ( busy_poll_us > 0 ) {
+      for ( const auto& link : links ) {
+        link->socket().set_busy_poll( busy_poll_us );
+      }
+    }
+
+    // send whatever the interfaces have ready
+    const auto transmit = [&] {
+      for ( size_t i = 0; i < links.size(); i++ ) {
+        links[i]->transmit( router.interface( i ) );
+      }
+    };
+
+    EventLoop loop;
+    for ( size_t i = 0; i < links.size(); i++ ) {
+      loop.add( links[i]->socket(), [&, i] { links[i]->receive( router.interface( i ) ); } );
+    }
+    loop.after_reads( [&] {
+      router.route();
+      transmit();
+    } );
+    loop.add_ticker( TICK_MS, [&]( const uint64_t ms ) {
+      for ( size_t i = 0; i < links.size(); i++ ) {
+        router.interface( i ).tick( ms );
+      }
+      transmit();
+    } );
+    loop.set_polling( options.polling_us );
+    loop.run();
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#include "worker_pool.hh"
+
+#include <stdexcept>
+
+using namespace std;
+
+WorkerPool::WorkerPool( const size_t workers )
+{
+  if ( workers == 0 ) {
+    throw runtime_error( "WorkerPool: need at least one worker" );
+  }
+  for ( size_t w = 1; w < workers; w++ ) {
+    threads_.emplace_back( [this, w] { work( w ); } );
+  }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    const lock_guard lock { mutex_ };
+    stopping_ = true;
+  }
+  start_.notify_all();
+  for ( auto& thread : threads_ ) {
+    thread.join();
+  }
+}
+
+void WorkerPool::run( const function<void( size_t )>& task )
+{
+  {
+    const lock_guard lock { mutex_ };
+    task_ = &task;
+    running_ = threads_.size();
+    error_ = nullptr;
+    ++generation_;
+  }
+  start_.notify_all();
+
+  exception_ptr error;
+  try {
+    task( 0 );
+  } catch ( ... ) {
+    error = current_exception();
+  }
+
+  unique_lock lock { mutex_ };
+  done_.wait( lock, [this] { return running_ == 0; } );
+  task_ = nullptr;
+  if ( not error ) {
+    error = error_;
+  }
+  lock.unlock();
+
+  if ( error ) {
+    rethrow_exception( error );
+  }
+}
+
+void WorkerPool::work( const size_t worker )
+{
+  uint64_t seen = 0;
+  while ( true ) {
+    const function<void( size_t )>* task = nullptr;
+    {
+      unique_lock lock { mutex_ };
+      start_.wait( lock, [&] { return stopping_ or generation_ != seen; } );
+      if ( stopping_ ) {
+        return;
+      }
+      seen = generation_;
+      task = task_;
+    }
+
+    exception_ptr error;
+    try {
+      ( *task )( worker );
+    } catch ( ... ) {
+      error = current_exception();
+    }
+
+    const lock_guard lock { mutex_ };
+    if ( error ) {
+      error_ = error;
+    }
+    if ( --running_ == 0 ) {
+      done_.notify_one();
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed team of threads that work in lockstep: run() hands the same task to every worker
+// at once, and returns when all have finished. The calling thread is worker 0, so a pool of
+// N workers starts N - 1 threads, which sleep between tasks.
+class WorkerPool
+{
+public:
+  explicit WorkerPool( size_t workers );
+  ~WorkerPool();
+
+  WorkerPool( const WorkerPool& ) = delete;
+  WorkerPool& operator=( const WorkerPool& ) = delete;
+
+  size_t size() const { return threads_.size() + 1; }
+
+  // Call task( w ) for every worker w in [0, size()), each on its own thread, and wait for
+  // all of them. If any call throws, one of the exceptions is rethrown here.
+  void run( const std::function<void( size_t )>& task );
+
+private:
+  std::mutex mutex_ {};
+  std::condition_variable start_ {};
+  std::condition_variable done_ {};
+  const std::function<void( size_t )>* task_ = nullptr;
+  uint64_t generation_ = 0; // bumped for each task, so workers can tell a new one from the last
+  size_t running_ = 0;      // threads yet to finish the current task
+  bool stopping_ = false;
+  std::exception_ptr error_ {};
+  std::vector<std::thread> threads_ {};
+
+  void work( size_t worker );
+};
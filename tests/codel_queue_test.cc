@@ -0,0 +1,109 @@
+#include "codel_queue.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "CoDelQueue: " + what );
+  }
+}
+
+// A frame of `size` bytes (header included), tagged with `id` at the start of its payload
+EthernetFrame make_frame( uint32_t id, size_t size = 1000 )
+{
+  EthernetFrame frame;
+  string payload( size - EthernetHeader::LENGTH, 'x' );
+  payload.replace( 0, to_string( id ).size(), to_string( id ) );
+  frame.payload.emplace_back( move( payload ) );
+  return frame;
+}
+
+uint64_t total( const CoDelQueue::Statistics& statistics )
+{
+  return accumulate( statistics.delay_histogram.begin(), statistics.delay_histogram.end(), uint64_t { 0 } );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // the byte limit is enforced on arrival
+    {
+      CoDelQueue queue { { .byte_limit = 4500, .target_ms = 5, .interval_ms = 100 } };
+      for ( uint32_t i = 0; i < 6; i++ ) {
+        queue.push( make_frame( i ), 0 );
+      }
+      expect( queue.size() == 4 and queue.bytes() == 4000, "byte limit not enforced" );
+      expect( queue.statistics().overflow_drops == 2, "overflow drops not counted" );
+      expect( CoDelQueue::frame_size( *queue.pop( 0 ) ) == 1000, "frame changed in the queue" );
+    }
+
+    // a burst that drains, however slowly, within an interval is left alone
+    {
+      CoDelQueue queue;
+      for ( uint32_t i = 0; i < 50; i++ ) {
+        queue.push( make_frame( i ), 0 );
+      }
+      uint32_t next = 0;
+      for ( uint64_t now = 0; not queue.empty(); now += 2 ) {
+        const auto frame = queue.pop( now );
+        expect( frame.has_value(), "frame lost" );
+        expect( string_view { frame->payload.front() }.starts_with( to_string( next++ ) ), "frames reordered" );
+      }
+      expect( next == 50 and queue.statistics().codel_drops == 0, "burst was policed" );
+      expect( total( queue.statistics() ) == 50, "delays not recorded" );
+      expect( queue.statistics().delay_histogram[0] == 1 and queue.statistics().delay_histogram[1] == 0
+                and queue.statistics().delay_histogram[2] == 1,
+              "delays recorded in the wrong buckets" );
+      expect( not queue.pop( 100 ).has_value(), "empty queue produced a frame" );
+    }
+
+    // a persistent overload (11 frames in for every 10 out) builds a standing queue, which
+    // CoDel brings back down by dropping, while a plain FIFO would grow by 100 frames a second
+    {
+      CoDelQueue queue { { .byte_limit = 100 * 1000 * 1000, .target_ms = 5, .interval_ms = 100 } };
+      uint32_t id = 0;
+      uint64_t sent = 0;
+      for ( uint64_t now = 0; now < 30000; now++ ) {
+        if ( now % 10 == 0 ) {
+          queue.push( make_frame( id++ ), now );
+        }
+        queue.push( make_frame( id++ ), now );
+        sent += queue.pop( now ).has_value();
+      }
+
+      const auto& statistics = queue.statistics();
+      expect( statistics.codel_drops > 0, "standing queue was not policed" );
+      expect( statistics.overflow_drops == 0, "byte limit reached" );
+      expect( sent + statistics.codel_drops + queue.size() == id, "frames unaccounted for" );
+      expect( queue.size() < 100, "standing queue kept growing (" + to_string( queue.size() ) + " frames)" );
+      expect( total( statistics ) == sent, "delays not recorded" );
+
+      // once the overload ends, the queue drains and dropping stops
+      const uint64_t drops = statistics.codel_drops;
+      for ( uint64_t now = 30000; not queue.empty(); now++ ) {
+        queue.pop( now );
+      }
+      expect( statistics.codel_drops - drops < 300, "kept dropping after the overload ended" );
+      for ( uint64_t now = 40000; now < 41000; now++ ) {
+        queue.push( make_frame( id++ ), now );
+        expect( queue.pop( now ).has_value(), "frame dropped from an idle queue" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
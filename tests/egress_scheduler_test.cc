@@ -0,0 +1,112 @@
+#include "egress_scheduler.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+using Class = EgressScheduler::Class;
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "EgressScheduler: " + what );
+  }
+}
+
+// A frame of 1000 bytes whose payload starts with `tag`
+EthernetFrame make_frame( char tag )
+{
+  EthernetFrame frame;
+  frame.payload.emplace_back( string( 1000 - EthernetHeader::LENGTH, tag ) );
+  return frame;
+}
+
+// Tags of the next `n` frames out of the scheduler
+string pop_tags( EgressScheduler& scheduler, size_t n, uint64_t now = 0 )
+{
+  string tags;
+  for ( size_t i = 0; i < n; i++ ) {
+    auto frame = scheduler.pop( now );
+    tags += frame.has_value() ? string_view { frame->payload.front() }.front() : '-';
+  }
+  return tags;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // DSCP classification
+    expect( EgressScheduler::classify( 48 ) == Class::Control, "CS6 misclassified" );
+    expect( EgressScheduler::classify( 46 ) == Class::Realtime, "EF misclassified" );
+    expect( EgressScheduler::classify( 10 ) == Class::Assured, "AF11 misclassified" );
+    expect( EgressScheduler::classify( 34 ) == Class::Assured, "AF41 misclassified" );
+    expect( EgressScheduler::classify( 0 ) == Class::BestEffort, "default misclassified" );
+    expect( EgressScheduler::classify( 8 ) == Class::BestEffort, "CS1 misclassified" );
+    expect( EgressScheduler::classify( 63 ) == Class::BestEffort, "unknown DSCP misclassified" );
+    expect( EgressScheduler::classify( 24 ) == Class::Assured, "CS3 misclassified" );
+    expect( EgressScheduler::classify( 11 ) == Class::BestEffort and EgressScheduler::classify( 17 ) == Class::BestEffort,
+            "unassigned DSCP misclassified" );
+
+    // strict priority over everything, then weighted round-robin (4:1) between the rest
+    {
+      EgressScheduler scheduler;
+      for ( int i = 0; i < 10; i++ ) {
+        scheduler.push( make_frame( 'b' ), Class::BestEffort, 0 );
+        scheduler.push( make_frame( 'a' ), Class::Assured, 0 );
+      }
+      scheduler.push( make_frame( 'r' ), Class::Realtime, 0 );
+      scheduler.push( make_frame( 'c' ), Class::Control, 0 );
+      expect( scheduler.size() == 22, "wrong size" );
+
+      expect( pop_tags( scheduler, 2 ) == "cr", "priority classes not served first" );
+      expect( pop_tags( scheduler, 10 ) == "aaaabaaaab", "round-robin weights not honored" );
+
+      // a priority frame goes straight to the front
+      scheduler.push( make_frame( 'r' ), Class::Realtime, 0 );
+      expect( pop_tags( scheduler, 2 ) == "ra", "priority frame waited" );
+
+      // with one class empty, the other gets everything
+      expect( pop_tags( scheduler, 10 ) == "abbbbbbbb-", "idle class held up the other" );
+      expect( scheduler.empty(), "frames left behind" );
+    }
+
+    // per-class limits and counters, and adjustable weights
+    {
+      EgressScheduler scheduler;
+      scheduler.queue( Class::Realtime ).set_config( { .byte_limit = 3000, .target_ms = 5, .interval_ms = 100 } );
+      scheduler.set_weight( Class::BestEffort, 2 );
+      scheduler.set_weight( Class::Assured, 1 );
+      for ( int i = 0; i < 5; i++ ) {
+        scheduler.push( make_frame( 'r' ), Class::Realtime, 0 );
+        scheduler.push( make_frame( 'a' ), Class::Assured, 0 );
+        scheduler.push( make_frame( 'b' ), Class::BestEffort, 0 );
+      }
+
+      expect( scheduler.queue( Class::Realtime ).statistics().overflow_drops == 2, "class limit not enforced" );
+      expect( pop_tags( scheduler, 9 ) == "rrrabbabb", "adjusted weights not honored" );
+      expect( scheduler.queue( Class::Realtime ).statistics().sent == 3, "sent frames not counted" );
+      expect( scheduler.queue( Class::Assured ).statistics().sent_bytes == 2000, "sent bytes not counted" );
+
+      bool threw = false;
+      try {
+        scheduler.set_weight( Class::Control, 3 );
+      } catch ( const runtime_error& ) {
+        threw = true;
+      }
+      expect( threw, "a priority class was given a weight" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
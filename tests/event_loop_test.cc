@@ -0,0 +1,151 @@
+#include "event_loop.hh"
+
+#include "exception.hh"
+#include "socket.hh"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "EventLoop: " + what );
+  }
+}
+
+// The read and write ends of a non-blocking pipe
+pair<FileDescriptor, FileDescriptor> make_pipe()
+{
+  int fds[2];
+  CheckSystemCall( "pipe2", pipe2( fds, O_NONBLOCK | O_CLOEXEC ) ); // NOLINT(*-bitwise)
+  return { FileDescriptor { fds[0] }, FileDescriptor { fds[1] } };
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // reads, and the callback after them
+    {
+      EventLoop loop;
+      auto [reader, writer] = make_pipe();
+      string received, buffer;
+      unsigned rounds = 0;
+      loop.add( reader, [&] {
+        reader.read( buffer );
+        received += buffer;
+        if ( reader.eof() ) {
+          loop.remove( reader );
+        }
+      } );
+      loop.after_reads( [&] { ++rounds; } );
+
+      expect( loop.wait_next_event( 0 ) and rounds == 0, "callbacks ran with nothing to read" );
+      writer.write( "hello" );
+      expect( loop.wait_next_event( 1000 ), "nothing registered" );
+      expect( received == "hello" and rounds == 1, "read or after_reads callback not called once" );
+
+      // a hangup is readable (at EOF), and the callback may remove its own registration
+      writer.close();
+      expect( loop.wait_next_event( 1000 ) and rounds == 2, "hangup not reported as readable" );
+      expect( not loop.wait_next_event( 0 ), "registration not removed" );
+
+      bool threw = false;
+      try {
+        loop.add( make_pipe().first, [] {} );
+        auto [other_reader, other_writer] = make_pipe();
+        loop.add( other_reader, [] {} );
+        loop.add( other_reader, [] {} );
+      } catch ( const runtime_error& ) {
+        threw = true;
+      }
+      expect( threw, "descriptor registered twice" );
+    }
+
+    // write interest: only while there is something to write
+    {
+      EventLoop loop;
+      auto [reader, writer] = make_pipe();
+      unsigned writes = 0;
+      loop.add( writer, {}, [&] {
+        writer.write( "x" );
+        if ( ++writes == 3 ) {
+          loop.set_write_interest( writer, false );
+        }
+      } );
+
+      for ( int i = 0; i < 5; i++ ) {
+        loop.wait_next_event( 0 );
+      }
+      expect( writes == 3, "write callback called while not interested" );
+
+      loop.set_write_interest( writer, true );
+      loop.wait_next_event( 1000 );
+      expect( writes == 4, "write interest not restored" );
+    }
+
+    // tickers report the monotonic time that passed, and are not input
+    {
+      EventLoop loop;
+      uint64_t total = 0;
+      unsigned ticks = 0;
+      bool routed = false;
+      loop.after_reads( [&] { routed = true; } );
+      const uint64_t start = EventLoop::monotonic_ms();
+      loop.add_ticker( 5, [&]( const uint64_t ms ) {
+        total += ms;
+        if ( ++ticks == 10 ) {
+          loop.stop();
+        }
+      } );
+      loop.run();
+      const uint64_t elapsed = EventLoop::monotonic_ms() - start;
+
+      expect( ticks == 10, "ticker did not run until stopped" );
+      expect( total >= 45 and total <= elapsed, "ticks do not add up to the time that passed" );
+      expect( not routed, "a tick counted as input" );
+    }
+
+    // polling: spin while input is recent, then go back to sleep
+    {
+      EventLoop loop;
+      auto [reader, writer] = make_pipe();
+      string buffer;
+      loop.add( reader, [&] { reader.read( buffer ); } );
+      loop.add_ticker( 60, [&]( uint64_t ) { loop.stop(); } );
+      loop.set_polling( 20000 );
+
+      writer.write( "x" );
+      loop.run();
+      const auto& statistics = loop.statistics();
+      expect( statistics.input_rounds == 1, "wrong number of input rounds" );
+      expect( statistics.polls > 0 and statistics.empty_polls + 1 >= statistics.polls, "did not poll after input" );
+      expect( statistics.sleeps >= 2, "did not sleep before input, or go back to sleep after it" );
+    }
+
+    // sockets can be asked to busy-poll their device queue too
+    {
+      UDPSocket socket;
+      socket.set_busy_poll( 0 );
+      int busy_poll = -1;
+      socklen_t length = sizeof( busy_poll );
+      CheckSystemCall( "getsockopt", getsockopt( socket.fd_num(), SOL_SOCKET, SO_BUSY_POLL, &busy_poll, &length ) );
+      expect( busy_poll == 0, "SO_BUSY_POLL not set" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "MacAddress: " + what );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const EthernetAddress bytes { 0x02, 0x11, 0x22, 0x33, 0x44, 0x55 };
+    const MacAddress mac { bytes };
+
+    // conversions to and from the six-byte form
+    expect( mac.value() == 0x021122334455, "bytes packed in the wrong order" );
+    expect( mac.to_array() == bytes, "round trip through the array form changed the address" );
+    expect( MacAddress::from_integer( 0xffff021122334455 ) == mac, "bits above 48 not ignored" );
+    expect( to_string( mac ) == to_string( bytes ), "printed differently from the array form" );
+
+    // classification
+    expect( MacAddress { ETHERNET_BROADCAST }.is_broadcast(), "broadcast not recognized" );
+    expect( MacAddress { ETHERNET_BROADCAST }.is_multicast(), "broadcast is not a group address" );
+    expect( MacAddress { { 0x01, 0x00, 0x5e, 0x00, 0x00, 0x01 } }.is_multicast(), "multicast not recognized" );
+    expect( not mac.is_multicast() and not mac.is_broadcast(), "unicast address misclassified" );
+
+    // hashing: distinct for addresses that differ in a single byte
+    unordered_set<MacAddress> seen;
+    for ( size_t i = 0; i < bytes.size(); i++ ) {
+      EthernetAddress other = bytes;
+      other.at( i ) ^= 0x80;
+      seen.insert( other );
+    }
+    seen.insert( mac );
+    expect( seen.size() == bytes.size() + 1 and seen.contains( bytes ), "hash set lost an address" );
+
+    // the wire format is unchanged: six bytes per address
+    EthernetHeader header { ETHERNET_BROADCAST, mac, EthernetHeader::TYPE_ARP };
+    string wire;
+    for ( const auto& buffer : serialize( header ) ) {
+      wire += string_view { buffer };
+    }
+    expect( wire.size() == EthernetHeader::LENGTH, "header serialized to the wrong length" );
+    expect( wire.substr( 0, 12 ) == "\xff\xff\xff\xff\xff\xff\x02\x11\x22\x33\x44\x55", "addresses serialized wrong" );
+
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REQUEST;
+    arp.sender_ethernet_address = mac;
+    arp.target_ethernet_address = ETHERNET_BROADCAST;
+    Parser parser { serialize( arp ) };
+    ARPMessage parsed;
+    parsed.parse( parser );
+    expect( not parser.has_error() and parsed.supported(), "ARP message did not parse" );
+    expect( parsed.sender_ethernet_address == mac and parsed.target_ethernet_address.is_broadcast(),
+            "ARP addresses changed in a round trip" );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+#include "neighbor_table.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "NeighborTable: " + what );
+  }
+}
+
+EthernetAddress ethernet_address_for( uint32_t ip )
+{
+  return { 0x02, 0, static_cast<uint8_t>( ip >> 24 ), static_cast<uint8_t>( ip >> 16 ),
+           static_cast<uint8_t>( ip >> 8 ), static_cast<uint8_t>( ip ) };
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    constexpr uint32_t base = 0x0a000000; // 10.0.0.0
+    constexpr uint32_t count = 150000;
+
+    NeighborTable table;
+
+    // learn many neighbors (consecutive addresses are the worst case for a weak hash)
+    for ( uint32_t i = 0; i < count; i++ ) {
+      auto [entry, inserted] = table.find_or_insert( base + i, NeighborTable::State::Reachable );
+      expect( inserted, "fresh address reported as already present" );
+      expect( entry->state == NeighborTable::State::Reachable, "new entry not in its initial state" );
+      entry->timestamp = i;
+      entry->set_ethernet_address( ethernet_address_for( base + i ) );
+    }
+    expect( table.size() == count, "wrong size after insertion" );
+    expect( table.find( base )->state == NeighborTable::State::Reachable, "state lost next to the address" );
+
+    for ( uint32_t i = 0; i < count; i++ ) {
+      const NeighborTable::Entry* entry = table.find( base + i );
+      expect( entry != nullptr, "learned neighbor not found" );
+      expect( entry->ethernet_address() == ethernet_address_for( base + i ), "wrong Ethernet address" );
+      expect( entry->timestamp == i, "wrong timestamp" );
+    }
+    expect( table.find( base + count ) == nullptr, "unknown neighbor found" );
+    const auto [existing, inserted] = table.find_or_insert( base, NeighborTable::State::Incomplete );
+    expect( not inserted, "existing address reported as inserted" );
+    expect( existing->state == NeighborTable::State::Reachable, "existing entry's state changed" );
+
+    // forget every other neighbor, one at a time and in bulk
+    for ( uint32_t i = 0; i < count / 2; i += 2 ) {
+      table.erase( base + i );
+    }
+    table.erase_if( [&]( const NeighborTable::Entry& entry ) {
+      return entry.ip >= base + count / 2 and ( entry.ip - base ) % 2 == 0;
+    } );
+    expect( table.size() == count / 2, "wrong size after erasure" );
+
+    for ( uint32_t i = 0; i < count; i++ ) {
+      const bool present = table.find( base + i ) != nullptr;
+      expect( present == ( i % 2 == 1 ), "erasure lost or kept the wrong neighbor" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
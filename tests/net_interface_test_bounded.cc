@@ -0,0 +1,176 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+EthernetAddress random_private_ethernet_address()
+{
+  EthernetAddress addr;
+  for ( auto& byte : addr ) {
+    byte = random_device()(); // use a random local Ethernet address
+  }
+  addr.at( 0 ) |= 0x02; // "10" in last two binary digits marks a private Ethernet address
+  addr.at( 0 ) &= 0xfe;
+
+  return addr;
+}
+
+InternetDatagram make_datagram( const string& src_ip, const string& dst_ip ) // NOLINT(*-swappable-*)
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address( src_ip, 0 ).ipv4_numeric();
+  dgram.header.dst = Address( dst_ip, 0 ).ipv4_numeric();
+  dgram.payload.emplace_back( "hello" );
+  dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + dgram.payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+ARPMessage make_arp( const uint16_t opcode,
+                     const EthernetAddress sender_ethernet_address,
+                     const string& sender_ip_address,
+                     const EthernetAddress target_ethernet_address,
+                     const string& target_ip_address )
+{
+  ARPMessage arp;
+  arp.opcode = opcode;
+  arp.sender_ethernet_address = sender_ethernet_address;
+  arp.sender_ip_address = Address( sender_ip_address, 0 ).ipv4_numeric();
+  arp.target_ethernet_address = target_ethernet_address;
+  arp.target_ip_address = Address( target_ip_address, 0 ).ipv4_numeric();
+  return arp;
+}
+
+EthernetFrame make_frame( const EthernetAddress& src,
+                          const EthernetAddress& dst,
+                          const uint16_t type,
+                          vector<Buffer> payload )
+{
+  EthernetFrame frame;
+  frame.header.src = src;
+  frame.header.dst = dst;
+  frame.header.type = type;
+  frame.payload = std::move( payload );
+  return frame;
+}
+
+struct SetNeighborLimits : public Action<NetworkInterface>
+{
+  size_t max_neighbors, max_incomplete;
+
+  std::string description() const override
+  {
+    return "limit ARP cache to " + to_string( max_neighbors ) + " mappings, " + to_string( max_incomplete )
+           + " incomplete";
+  }
+  void execute( NetworkInterface& interface ) const override
+  {
+    interface.set_neighbor_limits( max_neighbors, max_incomplete );
+  }
+
+  SetNeighborLimits( size_t n, size_t i ) : max_neighbors( n ), max_incomplete( i ) {}
+};
+
+struct ExpectNeighborCount : public Expectation<NetworkInterface>
+{
+  size_t expected;
+
+  std::string description() const override { return to_string( expected ) + " mapping(s) in the ARP cache"; }
+  void execute( NetworkInterface& interface ) const override
+  {
+    if ( interface.neighbor_count() != expected ) {
+      throw ExpectationViolation( "neighbor_count", expected, interface.neighbor_count() );
+    }
+  }
+
+  explicit ExpectNeighborCount( size_t e ) : expected( e ) {}
+};
+
+struct ExpectStatistic : public Expectation<NetworkInterface>
+{
+  std::string name;
+  uint64_t NetworkInterface::Statistics::*field;
+  uint64_t expected;
+
+  std::string description() const override { return name + " = " + to_string( expected ); }
+  void execute( NetworkInterface& interface ) const override
+  {
+    if ( interface.statistics().*field != expected ) {
+      throw ExpectationViolation( name, expected, interface.statistics().*field );
+    }
+  }
+
+  ExpectStatistic( std::string n, uint64_t NetworkInterface::Statistics::*f, uint64_t e )
+    : name( std::move( n ) ), field( f ), expected( e )
+  {}
+};
+
+int main()
+{
+  try {
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "ARP cache stays bounded", local_eth, Address( "10.0.0.1", 0 ) };
+      test.execute( SetNeighborLimits { 4, 2 } );
+
+      // ARP aimed at someone else does not teach us anything
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth,
+          ETHERNET_BROADCAST,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REQUEST, remote_eth, "10.0.0.9", {}, "10.0.0.200" ) ) ),
+        {} } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectNeighborCount { 0 } );
+
+      // at most two neighbors are resolved at once
+      for ( const string next_hop : { "10.0.0.9", "10.0.0.10" } ) {
+        test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.10" ), Address( next_hop, 0 ) } );
+        test.execute( ExpectFrame { make_frame(
+          local_eth,
+          ETHERNET_BROADCAST,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, next_hop ) ) ) } );
+      }
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.10" ), Address( "10.0.0.11", 0 ) } );
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectStatistic {
+        "resolution_limit_drops", &NetworkInterface::Statistics::resolution_limit_drops, 1 } );
+
+      // a flood of requests from new senders is answered, but only the table's worth is kept
+      for ( unsigned i = 0; i < 10; i++ ) {
+        const EthernetAddress sender_eth = random_private_ethernet_address();
+        const string sender_ip = "10.0.1." + to_string( i + 1 );
+        test.execute( ReceiveFrame {
+          make_frame(
+            sender_eth,
+            ETHERNET_BROADCAST,
+            EthernetHeader::TYPE_ARP,
+            serialize( make_arp( ARPMessage::OPCODE_REQUEST, sender_eth, sender_ip, {}, "10.0.0.1" ) ) ),
+          {} } );
+        test.execute( ExpectFrame { make_frame(
+          local_eth,
+          sender_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, local_eth, "10.0.0.1", sender_eth, sender_ip ) ) ) } );
+      }
+      test.execute( ExpectNoFrame {} );
+      test.execute( ExpectNeighborCount { 4 } );
+      test.execute(
+        ExpectStatistic { "neighbor_evictions", &NetworkInterface::Statistics::neighbor_evictions, 8 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,251 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+EthernetAddress random_private_ethernet_address()
+{
+  EthernetAddress addr;
+  for ( auto& byte : addr ) {
+    byte = random_device()(); // use a random local Ethernet address
+  }
+  addr.at( 0 ) |= 0x02; // "10" in last two binary digits marks a private Ethernet address
+  addr.at( 0 ) &= 0xfe;
+
+  return addr;
+}
+
+InternetDatagram make_datagram( const string& src_ip, const string& dst_ip ) // NOLINT(*-swappable-*)
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address( src_ip, 0 ).ipv4_numeric();
+  dgram.header.dst = Address( dst_ip, 0 ).ipv4_numeric();
+  dgram.payload.emplace_back( "hello" );
+  dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + dgram.payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+ARPMessage make_arp( const uint16_t opcode,
+                     const EthernetAddress sender_ethernet_address,
+                     const string& sender_ip_address,
+                     const EthernetAddress target_ethernet_address,
+                     const string& target_ip_address )
+{
+  ARPMessage arp;
+  arp.opcode = opcode;
+  arp.sender_ethernet_address = sender_ethernet_address;
+  arp.sender_ip_address = Address( sender_ip_address, 0 ).ipv4_numeric();
+  arp.target_ethernet_address = target_ethernet_address;
+  arp.target_ip_address = Address( target_ip_address, 0 ).ipv4_numeric();
+  return arp;
+}
+
+EthernetFrame make_frame( const EthernetAddress& src,
+                          const EthernetAddress& dst,
+                          const uint16_t type,
+                          vector<Buffer> payload )
+{
+  EthernetFrame frame;
+  frame.header.src = src;
+  frame.header.dst = dst;
+  frame.header.type = type;
+  frame.payload = std::move( payload );
+  return frame;
+}
+
+struct ReceiveFrames : public Action<NetworkInterface>
+{
+  vector<EthernetFrame> frames;
+  vector<InternetDatagram> expected;
+
+  string description() const override { return "burst of " + to_string( frames.size() ) + " frames arrives"; }
+  void execute( NetworkInterface& interface ) const override
+  {
+    vector<InternetDatagram> datagrams;
+    datagrams.emplace_back(); // already in the caller's vector: must be left alone
+    const size_t appended = interface.recv_frames( frames, datagrams );
+
+    if ( appended != expected.size() or datagrams.size() != expected.size() + 1 ) {
+      throw ExpectationViolation( "datagrams passed up the stack", expected.size(), appended );
+    }
+    for ( size_t i = 0; i < expected.size(); i++ ) {
+      if ( not equal( datagrams.at( i + 1 ), expected.at( i ) ) ) {
+        throw ExpectationViolation( "NetworkInterface::recv_frames() produced a different Internet datagram than "
+                                    "was expected: actual={"
+                                    + datagrams.at( i + 1 ).header.to_string() + "}" );
+      }
+    }
+  }
+
+  ReceiveFrames( vector<EthernetFrame> f, vector<InternetDatagram> e )
+    : frames( std::move( f ) ), expected( std::move( e ) )
+  {}
+};
+
+struct ExpectFrames : public Expectation<NetworkInterface>
+{
+  size_t room;
+  vector<EthernetFrame> expected;
+
+  string description() const override
+  {
+    return "up to " + to_string( room ) + " frames drained, " + to_string( expected.size() ) + " expected";
+  }
+  void execute( NetworkInterface& interface ) const override
+  {
+    vector<EthernetFrame> frames( room );
+    const size_t drained = interface.drain_frames( frames );
+
+    if ( drained != expected.size() ) {
+      throw ExpectationViolation( "frames drained", expected.size(), drained );
+    }
+    for ( size_t i = 0; i < drained; i++ ) {
+      if ( not equal( frames.at( i ), expected.at( i ) ) ) {
+        throw ExpectationViolation( "NetworkInterface drained a different Ethernet frame than was expected: actual={"
+                                    + summary( frames.at( i ) ) + "}" );
+      }
+    }
+  }
+
+  ExpectFrames( size_t r, vector<EthernetFrame> e ) : room( r ), expected( std::move( e ) ) {}
+};
+
+int main()
+{
+  try {
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "burst receive", local_eth, Address( "4.3.2.1", 0 ) };
+
+      // a datagram waits for its next hop
+      const auto outbound = make_datagram( "5.6.7.8", "13.12.11.10" );
+      test.execute( SendDatagram { outbound, Address( "192.168.0.1", 0 ) } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "4.3.2.1", {}, "192.168.0.1" ) ) ) } );
+
+      // a burst mixing datagrams for us, one for someone else, and the reply we were waiting for
+      const auto first = make_datagram( "1.2.3.4", "4.3.2.1" );
+      const auto second = make_datagram( "1.2.3.5", "4.3.2.1" );
+      const auto third = make_datagram( "1.2.3.6", "4.3.2.1" );
+      test.execute( ReceiveFrames {
+        { make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( first ) ),
+          make_frame( remote_eth,
+                      random_private_ethernet_address(),
+                      EthernetHeader::TYPE_IPv4,
+                      serialize( make_datagram( "1.2.3.4", "9.9.9.9" ) ) ),
+          make_frame( remote_eth, ETHERNET_BROADCAST, EthernetHeader::TYPE_IPv4, serialize( second ) ),
+          make_frame(
+            remote_eth,
+            local_eth,
+            EthernetHeader::TYPE_ARP,
+            serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "192.168.0.1", local_eth, "4.3.2.1" ) ) ),
+          make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( third ) ) },
+        { first, second, third } } );
+
+      // the reply released the waiting datagram
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( outbound ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // an empty burst, and one with nothing for us, pass nothing up
+      test.execute( ReceiveFrames { {}, {} } );
+      test.execute( ReceiveFrames {
+        { make_frame( remote_eth,
+                      random_private_ethernet_address(),
+                      EthernetHeader::TYPE_IPv4,
+                      serialize( make_datagram( "1.2.3.4", "9.9.9.9" ) ) ) },
+        {} } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "ARP requests in a burst are answered", local_eth, Address( "4.3.2.1", 0 ) };
+
+      const auto datagram = make_datagram( "1.2.3.4", "4.3.2.1" );
+      test.execute( ReceiveFrames {
+        { make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) ),
+          make_frame(
+            remote_eth,
+            ETHERNET_BROADCAST,
+            EthernetHeader::TYPE_ARP,
+            serialize( make_arp( ARPMessage::OPCODE_REQUEST, remote_eth, "1.2.3.4", {}, "4.3.2.1" ) ) ) },
+        { datagram } } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        remote_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, local_eth, "4.3.2.1", remote_eth, "1.2.3.4" ) ) ) } );
+
+      // and the requester was learnt along the way
+      const auto outbound = make_datagram( "5.6.7.8", "13.12.11.10" );
+      test.execute( SendDatagram { outbound, Address( "1.2.3.4", 0 ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( outbound ) ) } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "burst transmit", local_eth, Address( "4.3.2.1", 0 ) };
+
+      // a request from the neighbor is answered (and teaches us its address)...
+      test.execute( ReceiveFrame {
+        make_frame( remote_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, remote_eth, "1.2.3.4", {}, "4.3.2.1" ) ) ),
+        {} } );
+      const auto reply = make_frame(
+        local_eth,
+        remote_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, local_eth, "4.3.2.1", remote_eth, "1.2.3.4" ) ) );
+
+      // ...so datagrams to it go straight out
+      vector<EthernetFrame> sent;
+      for ( int i = 0; i < 4; i++ ) {
+        const auto datagram = make_datagram( "5.6.7.8", "13.12.11." + to_string( i ) );
+        test.execute( SendDatagram { datagram, Address( "1.2.3.4", 0 ) } );
+        sent.push_back( make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) ) );
+      }
+
+      // drained in order, no more than fit at a time
+      test.execute( ExpectFrames { 3, { reply, sent.at( 0 ), sent.at( 1 ) } } );
+      test.execute( ExpectFrames { 8, { sent.at( 2 ), sent.at( 3 ) } } );
+      test.execute( ExpectFrames { 8, {} } );
+      test.execute( ExpectNoFrame {} );
+
+      // and the two ways of transmitting can be mixed
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.10" ), Address( "1.2.3.4", 0 ) } );
+      test.execute( SendDatagram { make_datagram( "5.6.7.8", "13.12.11.9" ), Address( "1.2.3.4", 0 ) } );
+      test.execute( ExpectFrame { make_frame( local_eth,
+                                              remote_eth,
+                                              EthernetHeader::TYPE_IPv4,
+                                              serialize( make_datagram( "5.6.7.8", "13.12.11.10" ) ) ) } );
+      test.execute( ExpectFrames { 0, {} } );
+      test.execute( ExpectFrames { 1,
+                                   { make_frame( local_eth,
+                                                 remote_eth,
+                                                 EthernetHeader::TYPE_IPv4,
+                                                 serialize( make_datagram( "5.6.7.8", "13.12.11.9" ) ) ) } } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
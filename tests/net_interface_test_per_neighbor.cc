@@ -0,0 +1,193 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+EthernetAddress random_private_ethernet_address()
+{
+  EthernetAddress addr;
+  for ( auto& byte : addr ) {
+    byte = random_device()(); // use a random local Ethernet address
+  }
+  addr.at( 0 ) |= 0x02; // "10" in last two binary digits marks a private Ethernet address
+  addr.at( 0 ) &= 0xfe;
+
+  return addr;
+}
+
+InternetDatagram make_datagram( const string& src_ip, const string& dst_ip ) // NOLINT(*-swappable-*)
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address( src_ip, 0 ).ipv4_numeric();
+  dgram.header.dst = Address( dst_ip, 0 ).ipv4_numeric();
+  dgram.payload.emplace_back( "hello" );
+  dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + dgram.payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// A datagram carrying `size` bytes of payload, tagged with `id` at the start
+InternetDatagram make_sized_datagram( uint32_t id, size_t size )
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address( "5.6.7.8", 0 ).ipv4_numeric();
+  dgram.header.dst = Address( "13.12.11.10", 0 ).ipv4_numeric();
+  string payload( size, 'x' );
+  payload.replace( 0, to_string( id ).size(), to_string( id ) );
+  dgram.payload.emplace_back( move( payload ) );
+  dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + size;
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+ARPMessage make_arp( const uint16_t opcode,
+                     const EthernetAddress sender_ethernet_address,
+                     const string& sender_ip_address,
+                     const EthernetAddress target_ethernet_address,
+                     const string& target_ip_address )
+{
+  ARPMessage arp;
+  arp.opcode = opcode;
+  arp.sender_ethernet_address = sender_ethernet_address;
+  arp.sender_ip_address = Address( sender_ip_address, 0 ).ipv4_numeric();
+  arp.target_ethernet_address = target_ethernet_address;
+  arp.target_ip_address = Address( target_ip_address, 0 ).ipv4_numeric();
+  return arp;
+}
+
+EthernetFrame make_frame( const EthernetAddress& src,
+                          const EthernetAddress& dst,
+                          const uint16_t type,
+                          vector<Buffer> payload )
+{
+  EthernetFrame frame;
+  frame.header.src = src;
+  frame.header.dst = dst;
+  frame.header.type = type;
+  frame.payload = std::move( payload );
+  return frame;
+}
+
+int main()
+{
+  try {
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth1 = random_private_ethernet_address();
+      const EthernetAddress remote_eth2 = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "pending datagrams are held per next hop", local_eth, Address( "10.0.0.1", 0 ) };
+
+      // two datagrams to two unresolved next hops
+      const auto datagram = make_datagram( "5.6.7.8", "13.12.11.10" );
+      test.execute( SendDatagram { datagram, Address( "10.0.0.5", 0 ) } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
+
+      const auto datagram2 = make_datagram( "5.6.7.8", "4.10.4.10" );
+      test.execute( SendDatagram { datagram2, Address( "10.0.0.19", 0 ) } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.19" ) ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // the second neighbor answers: only its datagram is released
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth2,
+          local_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth2, "10.0.0.19", local_eth, "10.0.0.1" ) ) ),
+        {} } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth2, EthernetHeader::TYPE_IPv4, serialize( datagram2 ) ) } );
+      test.execute( ExpectNoFrame {} );
+
+      // the first neighbor's request times out, taking its datagram with it
+      test.execute( Tick { 5010 } );
+      test.execute( ExpectNoFrame {} );
+
+      // a late reply teaches the mapping but has nothing left to release
+      test.execute( ReceiveFrame {
+        make_frame(
+          remote_eth1,
+          local_eth,
+          EthernetHeader::TYPE_ARP,
+          serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth1, "10.0.0.5", local_eth, "10.0.0.1" ) ) ),
+        {} } );
+      test.execute( ExpectNoFrame {} );
+
+      const auto datagram3 = make_datagram( "5.6.7.8", "13.12.11.10" );
+      test.execute( SendDatagram { datagram3, Address( "10.0.0.5", 0 ) } );
+      test.execute(
+        ExpectFrame { make_frame( local_eth, remote_eth1, EthernetHeader::TYPE_IPv4, serialize( datagram3 ) ) } );
+      test.execute( ExpectNoFrame {} );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test {
+        "each neighbor's pending datagrams are capped, oldest dropped first", local_eth, Address( "10.0.0.1", 0 ) };
+      const auto arp_request = make_frame(
+        local_eth,
+        ETHERNET_BROADCAST,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.7" ) ) );
+      const auto arp_reply = make_frame(
+        remote_eth,
+        local_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.7", local_eth, "10.0.0.1" ) ) );
+
+      // more than 64 datagrams: only the newest 64 are still waiting when the reply comes
+      vector<InternetDatagram> datagrams;
+      for ( uint32_t i = 0; i < 100; i++ ) {
+        datagrams.push_back( make_sized_datagram( i, 100 ) );
+        test.execute( SendDatagram { datagrams.back(), Address( "10.0.0.7", 0 ) } );
+      }
+      test.execute( ExpectFrame { arp_request } );
+      test.execute( ExpectNoFrame {} );
+
+      test.execute( ReceiveFrame { arp_reply, {} } );
+      for ( uint32_t i = 100 - 64; i < 100; i++ ) {
+        test.execute(
+          ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagrams[i] ) ) } );
+      }
+      test.execute( ExpectNoFrame {} );
+
+      // more than 64 KiB: only the newest 32 datagrams of 2020 bytes fit
+      test.execute( Tick { 30001 } ); // the mapping expires
+      datagrams.clear();
+      for ( uint32_t i = 0; i < 40; i++ ) {
+        datagrams.push_back( make_sized_datagram( i, 2000 ) );
+        test.execute( SendDatagram { datagrams.back(), Address( "10.0.0.7", 0 ) } );
+      }
+      test.execute( ExpectFrame { arp_request } );
+      test.execute( ExpectNoFrame {} );
+
+      test.execute( ReceiveFrame { arp_reply, {} } );
+      for ( uint32_t i = 40 - 32; i < 40; i++ ) {
+        test.execute(
+          ExpectFrame { make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( datagrams[i] ) ) } );
+      }
+      test.execute( ExpectNoFrame {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,190 @@
+#include "arp_message.hh"
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+#include "network_interface_test_harness.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+EthernetAddress random_private_ethernet_address()
+{
+  EthernetAddress addr;
+  for ( auto& byte : addr ) {
+    byte = random_device()(); // use a random local Ethernet address
+  }
+  addr.at( 0 ) |= 0x02; // "10" in last two binary digits marks a private Ethernet address
+  addr.at( 0 ) &= 0xfe;
+
+  return addr;
+}
+
+InternetDatagram make_datagram( const string& src_ip, const string& dst_ip ) // NOLINT(*-swappable-*)
+{
+  InternetDatagram dgram;
+  dgram.header.src = Address( src_ip, 0 ).ipv4_numeric();
+  dgram.header.dst = Address( dst_ip, 0 ).ipv4_numeric();
+  dgram.payload.emplace_back( "hello" );
+  dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + dgram.payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+ARPMessage make_arp( const uint16_t opcode,
+                     const EthernetAddress sender_ethernet_address,
+                     const string& sender_ip_address,
+                     const EthernetAddress target_ethernet_address,
+                     const string& target_ip_address )
+{
+  ARPMessage arp;
+  arp.opcode = opcode;
+  arp.sender_ethernet_address = sender_ethernet_address;
+  arp.sender_ip_address = Address( sender_ip_address, 0 ).ipv4_numeric();
+  arp.target_ethernet_address = target_ethernet_address;
+  arp.target_ip_address = Address( target_ip_address, 0 ).ipv4_numeric();
+  return arp;
+}
+
+EthernetFrame make_frame( const EthernetAddress& src,
+                          const EthernetAddress& dst,
+                          const uint16_t type,
+                          vector<Buffer> payload )
+{
+  EthernetFrame frame;
+  frame.header.src = src;
+  frame.header.dst = dst;
+  frame.header.type = type;
+  frame.payload = std::move( payload );
+  return frame;
+}
+
+struct SetIngressPolicer : public Action<NetworkInterface>
+{
+  optional<EgressScheduler::Class> traffic_class;
+  uint64_t rate, burst;
+
+  string description() const override
+  {
+    return "police received datagrams" + string( traffic_class.has_value() ? " of one class" : "" ) + " to "
+           + to_string( rate ) + " B/s, bursts of " + to_string( burst ) + " B";
+  }
+  void execute( NetworkInterface& interface ) const override
+  {
+    if ( traffic_class.has_value() ) {
+      interface.set_ingress_policer( *traffic_class, rate, burst );
+    } else {
+      interface.set_ingress_policer( rate, burst );
+    }
+  }
+
+  SetIngressPolicer( optional<EgressScheduler::Class> c, uint64_t r, uint64_t b )
+    : traffic_class( c ), rate( r ), burst( b )
+  {}
+};
+
+struct ExpectPolicerDrops : public Expectation<NetworkInterface>
+{
+  uint64_t expected;
+
+  string description() const override { return to_string( expected ) + " datagram(s) dropped by the policer"; }
+  void execute( NetworkInterface& interface ) const override
+  {
+    if ( interface.statistics().policer_drops != expected ) {
+      throw ExpectationViolation( "policer_drops", expected, interface.statistics().policer_drops );
+    }
+  }
+
+  explicit ExpectPolicerDrops( uint64_t e ) : expected( e ) {}
+};
+
+InternetDatagram with_dscp( InternetDatagram dgram, uint8_t dscp )
+{
+  dgram.header.tos = static_cast<uint8_t>( dscp << 2 );
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+int main()
+{
+  try {
+    // every datagram below is 25 bytes long
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "ingress policing", local_eth, Address( "4.3.2.1", 0 ) };
+      test.execute( SetIngressPolicer { {}, 25, 50 } );
+
+      const auto datagram = make_datagram( "5.6.7.8", "4.3.2.1" );
+      const auto frame = make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( datagram ) );
+
+      // a burst of two gets through, the third is over the limit
+      test.execute( ReceiveFrame { frame, datagram } );
+      test.execute( ReceiveFrame { frame, datagram } );
+      test.execute( ReceiveFrame { frame, {} } );
+      test.execute( ExpectPolicerDrops { 1 } );
+
+      // ARP is not policed
+      test.execute( ReceiveFrame {
+        make_frame( remote_eth,
+                    ETHERNET_BROADCAST,
+                    EthernetHeader::TYPE_ARP,
+                    serialize( make_arp( ARPMessage::OPCODE_REQUEST, remote_eth, "5.6.7.8", {}, "4.3.2.1" ) ) ),
+        {} } );
+      test.execute( ExpectFrame { make_frame(
+        local_eth,
+        remote_eth,
+        EthernetHeader::TYPE_ARP,
+        serialize( make_arp( ARPMessage::OPCODE_REPLY, local_eth, "4.3.2.1", remote_eth, "5.6.7.8" ) ) ) } );
+
+      // tokens come back at the configured rate
+      test.execute( Tick { 600 } );
+      test.execute( ReceiveFrame { frame, {} } );
+      test.execute( Tick { 400 } );
+      test.execute( ReceiveFrame { frame, datagram } );
+      test.execute( ReceiveFrame { frame, {} } );
+      test.execute( ExpectPolicerDrops { 3 } );
+
+      // and the bucket holds no more than a burst, however long it is left
+      test.execute( Tick { 60000 } );
+      test.execute( ReceiveFrame { frame, datagram } );
+      test.execute( ReceiveFrame { frame, datagram } );
+      test.execute( ReceiveFrame { frame, {} } );
+      test.execute( ExpectPolicerDrops { 4 } );
+    }
+
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterfaceTestHarness test { "per-class ingress policing", local_eth, Address( "4.3.2.1", 0 ) };
+      test.execute( SetIngressPolicer { EgressScheduler::Class::BestEffort, 25, 25 } );
+
+      const auto bulk = make_datagram( "5.6.7.8", "4.3.2.1" );
+      const auto voice = with_dscp( make_datagram( "5.6.7.9", "4.3.2.1" ), 46 );
+      const auto bulk_frame = make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( bulk ) );
+      const auto voice_frame = make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( voice ) );
+
+      // best effort is limited, other classes are not
+      test.execute( ReceiveFrame { bulk_frame, bulk } );
+      test.execute( ReceiveFrame { bulk_frame, {} } );
+      for ( int i = 0; i < 5; i++ ) {
+        test.execute( ReceiveFrame { voice_frame, voice } );
+      }
+      test.execute( ExpectPolicerDrops { 1 } );
+
+      // an interface-wide limit applies on top, and a class over its own limit does not use it up
+      test.execute( SetIngressPolicer { {}, 25, 50 } );
+      test.execute( ReceiveFrame { bulk_frame, {} } );
+      test.execute( ReceiveFrame { voice_frame, voice } );
+      test.execute( ReceiveFrame { voice_frame, voice } );
+      test.execute( ReceiveFrame { voice_frame, {} } );
+      test.execute( ExpectPolicerDrops { 3 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include "exception.hh"
+#include "socket.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <linux/if_ether.h>
+#include <optional>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "PacketSocket: " + what );
+  }
+}
+
+constexpr uint16_t TYPE_EXPERIMENT = 0x88b5; // IEEE 802 local experimental EtherType
+
+} // namespace
+
+int main()
+{
+  try {
+    optional<PacketSocket> socket;
+    try {
+      socket.emplace( SOCK_RAW, htons( ETH_P_ALL ) );
+    } catch ( const unix_error& e ) {
+      cerr << "skipping PacketSocket test: " << e.what() << endl;
+      return EXIT_SUCCESS; // no CAP_NET_RAW
+    }
+    socket->bind_to_interface( "lo" );
+
+    bool threw = false;
+    try {
+      socket->enable_rings( { .block_size = 1 << 16, .block_count = 4, .block_timeout_ms = 5, .frame_size = 100, .frame_count = 64 } );
+    } catch ( const runtime_error& ) {
+      threw = true;
+    }
+    expect( threw, "unaligned TX frame size accepted" );
+    socket->enable_rings( { .block_size = 1 << 16, .block_count = 4, .block_timeout_ms = 5, .frame_size = 2048, .frame_count = 64 } );
+
+    // more frames than the TX ring holds, plus one too large for a slot
+    constexpr uint32_t count = 200;
+    vector<EthernetFrame> outgoing;
+    for ( uint32_t seq = 0; seq < count; seq++ ) {
+      EthernetFrame frame;
+      frame.header = { EthernetAddress { 0x02, 0, 0, 0, 0, 2 }, EthernetAddress { 0x02, 0, 0, 0, 0, 1 }, TYPE_EXPERIMENT };
+      frame.payload.emplace_back( "frame " + to_string( seq ) + string( 46, '.' ) );
+      outgoing.push_back( move( frame ) );
+    }
+    outgoing[count / 2].payload.emplace_back( string( 4000, 'x' ) );
+
+    // send and receive at once, until every frame has come back around the loopback device
+    vector<bool> seen( count );
+    vector<uint32_t> order;
+    size_t sent = 0;
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds( 10 );
+    while ( order.size() < count - 1 and chrono::steady_clock::now() < deadline ) {
+      sent += socket->send_frames( span { outgoing }.subspan( sent ) );
+
+      pollfd readable { socket->fd_num(), POLLIN, 0 };
+      poll( &readable, 1, 10 );
+      vector<EthernetFrame> incoming;
+      socket->recv_frames( incoming, 32 );
+      for ( const auto& frame : incoming ) {
+        if ( frame.header.type != TYPE_EXPERIMENT ) {
+          continue;
+        }
+        const string payload { static_cast<string_view>( frame.payload.front() ) };
+        const uint32_t seq = stoul( payload.substr( 6 ) );
+        expect( seq < count and payload.size() == 6 + to_string( seq ).size() + 46, "frame corrupted" );
+        expect( frame.header.dst == EthernetAddress { 0x02, 0, 0, 0, 0, 2 }
+                  and frame.header.src == EthernetAddress { 0x02, 0, 0, 0, 0, 1 },
+                "frame header corrupted" );
+        if ( not seen[seq] ) {
+          seen[seq] = true;
+          order.push_back( seq );
+        }
+      }
+    }
+
+    expect( sent == count, "not every frame was taken" );
+    expect( order.size() == count - 1 and not seen[count / 2], "frames lost, or the oversized one sent" );
+    for ( size_t i = 1; i < order.size(); i++ ) {
+      expect( order[i - 1] < order[i], "frames reordered" );
+    }
+
+    const auto& statistics = socket->ring_statistics();
+    expect( statistics.tx_oversized == 1, "oversized frame not counted" );
+    expect( statistics.tx_kicks > 0 and statistics.tx_kicks < count / 2, "transmission not kicked once per burst" );
+    expect( statistics.blocks_released > 0, "no RX blocks given back" );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
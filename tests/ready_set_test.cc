@@ -0,0 +1,65 @@
+#include "ready_set.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "ReadySet: " + what );
+  }
+}
+
+vector<size_t> members( const ReadySet& set )
+{
+  vector<size_t> out;
+  set.for_each( [&]( size_t index ) { out.push_back( index ); } );
+  return out;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    ReadySet set;
+    set.reserve( 300 );
+    expect( set.empty() and members( set ).empty(), "new set not empty" );
+
+    // members are visited in order, across word boundaries, and counted once each
+    for ( const size_t index : { 299, 0, 64, 63, 130, 64 } ) {
+      set.insert( index );
+    }
+    expect( set.size() == 5, "wrong size after insertion" );
+    expect( members( set ) == vector<size_t> { 0, 63, 64, 130, 299 }, "members visited out of order" );
+    expect( set.contains( 130 ) and not set.contains( 131 ), "membership wrong" );
+
+    set.erase( 63 );
+    set.erase( 63 );
+    set.erase( 1 );
+    expect( set.size() == 4 and members( set ) == vector<size_t> { 0, 64, 130, 299 }, "erasure went wrong" );
+
+    // a walk may erase the member it is visiting
+    vector<size_t> visited;
+    set.for_each( [&]( size_t index ) {
+      visited.push_back( index );
+      if ( index % 2 == 0 ) {
+        set.erase( index );
+      }
+    } );
+    expect( visited == vector<size_t> { 0, 64, 130, 299 }, "erasing during a walk skipped members" );
+    expect( set.size() == 1 and members( set ) == vector<size_t> { 299 }, "erasing during a walk went wrong" );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+#include "arp_message.hh"
+#include "router.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Router fairness: " + what );
+  }
+}
+
+uint32_t ip( const string& str )
+{
+  return Address { str }.ipv4_numeric();
+}
+
+EthernetFrame make_frame( const EthernetAddress& src, const EthernetAddress& dst, uint16_t type, vector<Buffer> payload )
+{
+  EthernetFrame frame;
+  frame.header = { dst, src, type };
+  frame.payload = std::move( payload );
+  return frame;
+}
+
+InternetDatagram make_datagram( const string& src_ip, const string& dst_ip, const string& payload )
+{
+  InternetDatagram dgram;
+  dgram.header.src = ip( src_ip );
+  dgram.header.dst = ip( dst_ip );
+  dgram.payload.emplace_back( payload );
+  dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+// Source addresses (in order) of the datagrams a router sends out of `interface`
+vector<uint32_t> forwarded_sources( AsyncNetworkInterface& interface )
+{
+  vector<uint32_t> sources;
+  while ( auto frame = interface.maybe_send() ) {
+    InternetDatagram dgram;
+    if ( frame->header.type == EthernetHeader::TYPE_IPv4 and parse( dgram, frame->payload ) ) {
+      sources.push_back( dgram.header.src );
+    }
+  }
+  return sources;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const EthernetAddress in0_eth { 0x02, 0, 0, 0, 0, 1 };
+    const EthernetAddress in1_eth { 0x02, 0, 0, 0, 0, 2 };
+    const EthernetAddress out_eth { 0x02, 0, 0, 0, 0, 3 };
+    const EthernetAddress peer_eth { 0x02, 0, 0, 0, 0, 4 };
+    const EthernetAddress sender_eth { 0x02, 0, 0, 0, 0, 5 };
+
+    Router router;
+    const size_t in0 = router.add_interface( { in0_eth, Address { "10.0.0.1" } } );
+    const size_t in1 = router.add_interface( { in1_eth, Address { "10.1.0.1" } } );
+    const size_t out = router.add_interface( { out_eth, Address { "192.168.0.1" } } );
+    router.add_route( ip( "192.168.0.0" ), 24, {}, out );
+
+    // the router learns the receiving host's address from its ARP request
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REQUEST;
+    arp.sender_ethernet_address = peer_eth;
+    arp.sender_ip_address = ip( "192.168.0.2" );
+    arp.target_ip_address = ip( "192.168.0.1" );
+    router.interface( out ).recv_frame(
+      make_frame( peer_eth, ETHERNET_BROADCAST, EthernetHeader::TYPE_ARP, serialize( arp ) ) );
+    expect( router.interface( out ).maybe_send().has_value(), "ARP request not answered" );
+
+    const auto flood = make_datagram( "10.0.0.2", "192.168.0.2", "flood" );
+    const auto trickle = make_datagram( "10.1.0.2", "192.168.0.2", "other" );
+
+    // a flood on one interface, and a single datagram on another that arrived just after it
+    auto offer = [&]( size_t flood_count ) {
+      for ( size_t i = 0; i < flood_count; i++ ) {
+        router.interface( in0 ).recv_frame(
+          make_frame( sender_eth, in0_eth, EthernetHeader::TYPE_IPv4, serialize( flood ) ) );
+      }
+      router.interface( in1 ).recv_frame(
+        make_frame( sender_eth, in1_eth, EthernetHeader::TYPE_IPv4, serialize( trickle ) ) );
+    };
+
+    // with a quantum of one datagram, the interfaces alternate
+    router.set_quantum( flood.header.len );
+    offer( 100 );
+    router.route();
+    auto sources = forwarded_sources( router.interface( out ) );
+    expect( sources.size() == 101, "datagrams lost" );
+    expect( sources.at( 0 ) == ip( "10.0.0.2" ) and sources.at( 1 ) == ip( "10.1.0.2" ),
+            "quiet interface waited behind the flood" );
+
+    // with a quantum of several datagrams, it waits for at most one quantum's worth
+    router.set_quantum( 8 * flood.header.len );
+    offer( 100 );
+    router.route();
+    sources = forwarded_sources( router.interface( out ) );
+    expect( sources.size() == 101, "datagrams lost" );
+    expect( sources.at( 8 ) == ip( "10.1.0.2" ), "quiet interface did not get its turn in the first round" );
+
+    // credit smaller than a datagram builds up over rounds instead of stalling
+    router.set_quantum( 1 );
+    offer( 3 );
+    router.route();
+    expect( forwarded_sources( router.interface( out ) ).size() == 4, "datagrams left behind" );
+    expect( not router.interface( in0 ).has_received() and not router.interface( in1 ).has_received(),
+            "route() returned with datagrams waiting" );
+
+    bool threw = false;
+    try {
+      router.set_quantum( 0 );
+    } catch ( const runtime_error& ) {
+      threw = true;
+    }
+    expect( threw, "a zero quantum was accepted" );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include "arp_message.hh"
+#include "router.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Router speed test: " + what );
+  }
+}
+
+uint32_t ip( const string& str )
+{
+  return Address { str }.ipv4_numeric();
+}
+
+const EthernetAddress in_eth { 0x02, 0, 0, 0, 0, 1 };
+const EthernetAddress out_eth { 0x02, 0, 0, 0, 0, 2 };
+const EthernetAddress peer_eth { 0x02, 0, 0, 0, 0, 3 };
+
+constexpr size_t BURST = 256;   // frames offered per call to route()
+constexpr size_t ROUNDS = 2000; // calls to route() per mode
+constexpr size_t PAYLOAD = 512; // bytes of UDP payload per datagram
+constexpr uint8_t PROTO_UDP = 17;
+
+// A burst of UDP datagrams to a resolved neighbor, over many flows
+vector<EthernetFrame> make_burst()
+{
+  vector<EthernetFrame> burst;
+  for ( size_t i = 0; i < BURST; i++ ) {
+    InternetDatagram dgram;
+    dgram.header.proto = PROTO_UDP;
+    dgram.header.src = ip( "10.0.0.2" ) + static_cast<uint32_t>( i % 16 );
+    dgram.header.dst = ip( "172.16.0.1" ) + static_cast<uint32_t>( i );
+    dgram.payload.emplace_back( string( PAYLOAD, 'x' ) );
+    dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + PAYLOAD;
+    dgram.header.compute_checksum();
+
+    EthernetFrame frame;
+    frame.header = { in_eth, peer_eth, EthernetHeader::TYPE_IPv4 };
+    frame.payload = serialize( dgram );
+    burst.push_back( move( frame ) );
+  }
+  return burst;
+}
+
+struct Result
+{
+  double datagrams_per_second;
+  double mean_route_us;
+};
+
+// Offer ROUNDS bursts to a router in the given mode, calling route() after each, and time it
+Result measure( size_t workers, bool pipelined )
+{
+  Router router;
+  router.set_workers( workers );
+  router.set_pipelined( pipelined );
+  const size_t in = router.add_interface( { in_eth, Address { "10.0.0.1" } } );
+  const size_t out = router.add_interface( { out_eth, Address { "192.168.0.1" } } );
+  router.add_route( ip( "172.16.0.0" ), 12, Address { "192.168.0.2" }, out );
+  router.interface( out ).set_egress_queue( EgressScheduler::Class::BestEffort,
+                                            { .byte_limit = 1 << 30, .target_ms = 5, .interval_ms = 100 } );
+
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = peer_eth;
+  arp.sender_ip_address = ip( "192.168.0.2" );
+  arp.target_ethernet_address = out_eth;
+  arp.target_ip_address = ip( "192.168.0.1" );
+  router.interface( out ).recv_frame( { { out_eth, peer_eth, EthernetHeader::TYPE_ARP }, serialize( arp ) } );
+  while ( router.interface( out ).maybe_send() ) {}
+
+  const vector<EthernetFrame> burst = make_burst();
+  vector<EthernetFrame> sent( BURST );
+  size_t forwarded = 0;
+  nanoseconds routing { 0 };
+
+  const auto start = steady_clock::now();
+  for ( size_t round = 0; round < ROUNDS; round++ ) {
+    router.interface( in ).recv_frames( burst );
+    const auto before = steady_clock::now();
+    router.route();
+    routing += steady_clock::now() - before;
+    while ( const size_t count = router.interface( out ).drain_frames( sent ) ) {
+      forwarded += count;
+    }
+  }
+  const duration<double> elapsed = steady_clock::now() - start;
+
+  expect( forwarded == BURST * ROUNDS, "datagrams lost" );
+  return { static_cast<double>( forwarded ) / elapsed.count(),
+           static_cast<double>( duration_cast<nanoseconds>( routing ).count() ) / ROUNDS / 1000 };
+}
+
+void report( const string& mode, const Result& result )
+{
+  cout << "  " << left << setw( 22 ) << mode << right << fixed << setprecision( 2 ) << setw( 8 )
+       << result.datagrams_per_second / 1e6 << " Mdatagrams/s, " << setw( 9 ) << result.mean_route_us
+       << " us per route() of " << BURST << "\n";
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const size_t cores = max( 2U, thread::hardware_concurrency() );
+    cout << "Router forwarding, " << BURST << "-datagram bursts of " << PAYLOAD << "-byte UDP payloads:\n";
+    report( "run to completion", measure( 1, false ) );
+    report( "split over " + to_string( cores ) + " workers", measure( cores, false ) );
+    report( "pipelined, 3 stages", measure( 1, true ) );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
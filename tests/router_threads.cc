@@ -0,0 +1,296 @@
+#include "arp_message.hh"
+#include "router.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "Router threads: " + what );
+  }
+}
+
+uint32_t ip( const string& str )
+{
+  return Address { str }.ipv4_numeric();
+}
+
+EthernetFrame make_frame( const EthernetAddress& src, const EthernetAddress& dst, uint16_t type, vector<Buffer> payload )
+{
+  EthernetFrame frame;
+  frame.header = { dst, src, type };
+  frame.payload = std::move( payload );
+  return frame;
+}
+
+constexpr uint8_t PROTO_UDP = 17;
+
+// A UDP datagram of flow `flow`, carrying sequence number `seq` after the ports
+InternetDatagram make_datagram( uint32_t dst, uint16_t flow, uint32_t seq, uint8_t ttl = 64 )
+{
+  InternetDatagram dgram;
+  dgram.header.proto = PROTO_UDP;
+  dgram.header.src = ip( "10.0.0.2" );
+  dgram.header.dst = dst;
+  dgram.header.ttl = ttl;
+  string payload { static_cast<char>( flow >> 8 ), static_cast<char>( flow ), 0, 53 };
+  payload += to_string( seq );
+  dgram.payload.emplace_back( payload );
+  dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + payload.size();
+  dgram.header.compute_checksum();
+  return dgram;
+}
+
+const EthernetAddress in_eth { 0x02, 0, 0, 0, 0, 1 };
+const EthernetAddress out_eth { 0x02, 0, 0, 0, 0, 2 };
+const EthernetAddress peer_eth { 0x02, 0, 0, 0, 0, 3 };
+
+// Give the router an inside interface (returned) and an outside one, with a resolved peer
+size_t connect( Router& router )
+{
+  const size_t in = router.add_interface( { in_eth, Address { "10.0.0.1" } } );
+  const size_t out = router.add_interface( { out_eth, Address { "192.168.0.1" } } );
+  router.add_route( ip( "192.168.0.0" ), 24, {}, out );
+  router.add_route( ip( "172.16.0.0" ), 12, Address { "192.168.0.2" }, out );
+  router.interface( out ).set_egress_queue( EgressScheduler::Class::BestEffort,
+                                            { .byte_limit = 1 << 30, .target_ms = 5, .interval_ms = 100 } );
+
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = peer_eth;
+  arp.sender_ip_address = ip( "192.168.0.2" );
+  arp.target_ethernet_address = out_eth;
+  arp.target_ip_address = ip( "192.168.0.1" );
+  router.interface( out ).recv_frame( make_frame( peer_eth, out_eth, EthernetHeader::TYPE_ARP, serialize( arp ) ) );
+  while ( router.interface( out ).maybe_send() ) {}
+  return in;
+}
+
+// The `seq`th frame offered: a mix of directly attached and indirect destinations, with some
+// unroutable and some expiring
+EthernetFrame offered_frame( uint32_t seq, uint16_t flows )
+{
+  const uint32_t destinations[] = { ip( "192.168.0.2" ), ip( "172.20.1.1" ), ip( "8.8.8.8" ) };
+  const uint16_t flow = static_cast<uint16_t>( seq % flows );
+  const auto dgram = make_datagram( destinations[flow % 3], flow, seq, seq % 7 == 0 ? 1 : 64 );
+  return make_frame( peer_eth, in_eth, EthernetHeader::TYPE_IPv4, serialize( dgram ) );
+}
+
+// The (flow, sequence number) of a forwarded frame
+pair<uint16_t, uint32_t> forwarded_datagram( const EthernetFrame& frame )
+{
+  InternetDatagram dgram;
+  expect( parse( dgram, frame.payload ), "bad datagram forwarded" );
+  expect( dgram.header.ttl == 63, "TTL not decremented once" );
+  const string payload = dgram.payload.front();
+  const uint16_t flow = static_cast<uint16_t>( static_cast<uint8_t>( payload[0] ) << 8 | static_cast<uint8_t>( payload[1] ) );
+  return { flow, stoul( payload.substr( 4 ) ) };
+}
+
+// Offer `count` datagrams spread over `flows` flows to a router with `workers` workers (or
+// pipelined), routing twice along the way, and return the (flow, sequence number) of each
+// forwarded one, in the order sent
+vector<pair<uint16_t, uint32_t>> forward( size_t workers, uint32_t count, uint16_t flows, bool pipelined = false )
+{
+  Router router;
+  router.set_workers( workers );
+  router.set_pipelined( pipelined );
+  const size_t in = connect( router );
+  const size_t out = in + 1;
+
+  for ( uint32_t seq = 0; seq < count; seq++ ) {
+    router.interface( in ).recv_frame( offered_frame( seq, flows ) );
+    if ( seq == count / 2 ) {
+      router.route();
+    }
+  }
+  router.route();
+  router.route(); // nothing left
+
+  vector<pair<uint16_t, uint32_t>> forwarded;
+  while ( auto frame = router.interface( out ).maybe_send() ) {
+    forwarded.push_back( forwarded_datagram( *frame ) );
+  }
+  return forwarded;
+}
+
+// The same, but with an I/O thread exchanging frames with the router through the interfaces'
+// handoff rings (small ones, so that they are often full), until `expected` are forwarded
+vector<pair<uint16_t, uint32_t>> forward_from_io_thread( uint32_t count, uint16_t flows, size_t expected )
+{
+  Router router;
+  const size_t in = connect( router );
+  const size_t out = in + 1;
+  router.interface( in ).enable_handoff( 16 );
+  router.interface( out ).enable_handoff( 16 );
+
+  vector<pair<uint16_t, uint32_t>> forwarded;
+  atomic<bool> done { false };
+  thread io { [&] {
+    vector<EthernetFrame> offered;
+    for ( uint32_t seq = 0; seq < count; seq++ ) {
+      offered.push_back( offered_frame( seq, flows ) );
+    }
+    vector<EthernetFrame> collected( 8 );
+    for ( size_t delivered = 0; delivered < offered.size() or forwarded.size() < expected; ) {
+      const size_t batch = min<size_t>( 5, offered.size() - delivered );
+      delivered += router.interface( in ).deliver_frames( span { offered }.subspan( delivered, batch ) );
+      const size_t taken = router.interface( out ).collect_frames( collected );
+      for ( size_t i = 0; i < taken; i++ ) {
+        forwarded.push_back( forwarded_datagram( collected[i] ) );
+      }
+    }
+    done = true;
+  } };
+
+  while ( not done ) {
+    router.route();
+  }
+  io.join();
+  return forwarded;
+}
+
+// Send an ARP probe (RFC 5227) for the outside interface's address to a threaded router,
+// which answers it without learning (or sharing with its workers) the unset sender address
+void probe_threaded_router()
+{
+  Router router;
+  router.set_workers( 2 );
+  const size_t in = connect( router );
+  const size_t out = in + 1;
+
+  const EthernetAddress prober_eth { 0x02, 0, 0, 0, 0, 4 };
+  ARPMessage probe;
+  probe.opcode = ARPMessage::OPCODE_REQUEST;
+  probe.sender_ethernet_address = prober_eth;
+  probe.sender_ip_address = 0;
+  probe.target_ip_address = ip( "192.168.0.1" );
+  router.interface( out ).recv_frame( make_frame( prober_eth, ETHERNET_BROADCAST, EthernetHeader::TYPE_ARP, serialize( probe ) ) );
+
+  auto reply = router.interface( out ).maybe_send();
+  expect( reply.has_value() and reply->header.type == EthernetHeader::TYPE_ARP, "ARP probe not answered" );
+  expect( reply->header.dst == prober_eth, "ARP probe answered to the wrong address" );
+  expect( not router.interface( out ).maybe_send().has_value(), "ARP probe triggered more than one frame" );
+
+  // forwarding is unaffected
+  for ( uint32_t seq = 0; seq < 3; seq++ ) {
+    const auto dgram = make_datagram( ip( "192.168.0.2" ), 0, seq );
+    router.interface( in ).recv_frame( make_frame( peer_eth, in_eth, EthernetHeader::TYPE_IPv4, serialize( dgram ) ) );
+  }
+  router.route();
+  size_t forwarded = 0;
+  while ( auto frame = router.interface( out ).maybe_send() ) {
+    forwarded_datagram( *frame );
+    forwarded++;
+  }
+  expect( forwarded == 3, "datagrams lost after an ARP probe" );
+}
+
+// A datagram whose route cannot be followed (to an interface the router does not have) makes
+// a pipelined route() throw, without holding up the rest or leaving anything to send again
+void bad_route_in_pipeline()
+{
+  Router router;
+  router.set_pipelined( true );
+  const size_t in = connect( router );
+  const size_t out = in + 1;
+  router.add_route( ip( "10.9.0.0" ), 16, {}, 7 );
+
+  const auto offer = [&]( uint32_t dst, uint32_t seq ) {
+    router.interface( in ).recv_frame(
+      make_frame( peer_eth, in_eth, EthernetHeader::TYPE_IPv4, serialize( make_datagram( dst, 0, seq ) ) ) );
+  };
+  const auto forwarded = [&] {
+    size_t count = 0;
+    while ( auto frame = router.interface( out ).maybe_send() ) {
+      forwarded_datagram( *frame );
+      count++;
+    }
+    return count;
+  };
+
+  offer( ip( "192.168.0.2" ), 0 );
+  offer( ip( "10.9.0.1" ), 1 );
+  offer( ip( "192.168.0.2" ), 2 );
+  bool threw = false;
+  try {
+    router.route();
+  } catch ( const exception& ) {
+    threw = true;
+  }
+  expect( threw, "unusable route not reported" );
+  expect( forwarded() == 2, "datagrams around an unusable route lost" );
+
+  offer( ip( "192.168.0.2" ), 3 );
+  router.route();
+  expect( forwarded() == 1, "pipeline not working after an error" );
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    constexpr uint32_t count = 5000;
+    constexpr uint16_t flows = 60;
+    const auto serial = forward( 1, count, flows );
+
+    // two of every three flows are routable, and one datagram in seven has no TTL left
+    size_t expected = 0;
+    for ( uint32_t seq = 0; seq < count; seq++ ) {
+      expected += ( seq % flows ) % 3 != 2 and seq % 7 != 0;
+    }
+    expect( serial.size() == expected, "wrong number of datagrams forwarded" );
+
+    for ( const size_t workers : { 2, 4, 7 } ) {
+      const auto threaded = forward( workers, count, flows );
+      expect( threaded.size() == serial.size(), "threaded mode lost or invented datagrams" );
+
+      // every flow comes out complete and in order
+      map<uint16_t, vector<uint32_t>> serial_flows, threaded_flows;
+      for ( const auto& [flow, seq] : serial ) {
+        serial_flows[flow].push_back( seq );
+      }
+      for ( const auto& [flow, seq] : threaded ) {
+        threaded_flows[flow].push_back( seq );
+      }
+      expect( threaded_flows == serial_flows, "a flow was reordered across workers" );
+    }
+
+    // the pipeline keeps the order of everything, not only within each flow
+    expect( forward( 1, count, flows, true ) == serial, "pipelined mode changed the order of datagrams" );
+    expect( forward( 4, count, flows, true ) == serial, "pipelined mode changed the order of datagrams" );
+
+    // handing frames to and from another thread keeps them all, and in order
+    expect( forward_from_io_thread( count, flows, serial.size() ) == serial, "I/O thread handoff lost or reordered datagrams" );
+
+    probe_threaded_router();
+    bad_route_in_pipeline();
+
+    bool threw = false;
+    try {
+      Router router;
+      router.set_workers( 0 );
+    } catch ( const runtime_error& ) {
+      threw = true;
+    }
+    expect( threw, "zero workers accepted" );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+#include "arp_message.hh"
+#include "network_interface.hh"
+#include "seqlock_neighbor_table.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "SeqlockNeighborTable: " + what );
+  }
+}
+
+// An Ethernet address that records which IPv4 address it belongs to, and a version
+MacAddress mac_for( uint32_t ip, uint16_t version )
+{
+  return MacAddress::from_integer( uint64_t { ip } << 16 | version );
+}
+
+EthernetFrame arp_reply( const EthernetAddress& sender, uint32_t sender_ip, const EthernetAddress& target, uint32_t target_ip )
+{
+  ARPMessage arp;
+  arp.opcode = ARPMessage::OPCODE_REPLY;
+  arp.sender_ethernet_address = sender;
+  arp.sender_ip_address = sender_ip;
+  arp.target_ethernet_address = target;
+  arp.target_ip_address = target_ip;
+
+  EthernetFrame frame;
+  frame.header = { target, sender, EthernetHeader::TYPE_ARP };
+  frame.payload = serialize( arp );
+  return frame;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    constexpr uint32_t base = 0x0a000000; // 10.0.0.0
+
+    // store, replace and erase
+    {
+      SeqlockNeighborTable table { 64 };
+      expect( table.capacity() == 64, "wrong capacity" );
+      expect( not table.find( base + 1 ).has_value(), "empty table found a mapping" );
+
+      table.store( base + 1, mac_for( base + 1, 1 ) );
+      table.store( base + 2, mac_for( base + 2, 1 ) );
+      expect( table.find( base + 1 ) == mac_for( base + 1, 1 ), "stored mapping not found" );
+      table.store( base + 1, mac_for( base + 1, 2 ) );
+      expect( table.find( base + 1 ) == mac_for( base + 1, 2 ), "mapping not replaced" );
+      table.erase( base + 1 );
+      expect( not table.find( base + 1 ).has_value(), "erased mapping found" );
+      expect( table.find( base + 2 ) == mac_for( base + 2, 1 ), "erasure lost another mapping" );
+
+      // more mappings than fit: the most recent one is always kept, and none is ever wrong
+      for ( uint32_t i = 0; i < 1000; i++ ) {
+        table.store( base + i + 1, mac_for( base + i + 1, 3 ) );
+        expect( table.find( base + i + 1 ) == mac_for( base + i + 1, 3 ), "newest mapping not kept" );
+      }
+      for ( uint32_t i = 0; i < 1000; i++ ) {
+        const auto found = table.find( base + i + 1 );
+        expect( not found or *found == mac_for( base + i + 1, 3 ), "overflowing the table corrupted a mapping" );
+      }
+
+      bool threw = false;
+      try {
+        table.store( 0, mac_for( 0, 0 ) );
+      } catch ( const runtime_error& ) {
+        threw = true;
+      }
+      expect( threw, "0.0.0.0 accepted" );
+    }
+
+    // readers on other threads never see a torn or misplaced mapping while the writer churns
+    {
+      constexpr uint32_t neighbors = 200;
+      SeqlockNeighborTable table { 256 };
+      atomic<bool> done { false };
+      atomic<bool> torn { false };
+      atomic<uint64_t> hits { 0 };
+
+      vector<thread> readers;
+      for ( uint32_t r = 0; r < 3; r++ ) {
+        readers.emplace_back( [&, r] {
+          uint64_t found = 0;
+          for ( uint32_t i = r; not done.load( memory_order_relaxed ); i++ ) {
+            const uint32_t ip = base + 1 + i % neighbors;
+            if ( const auto mac = table.find( ip ) ) {
+              ++found;
+              if ( mac->value() >> 16 != ip ) {
+                torn = true;
+              }
+            }
+          }
+          hits += found;
+        } );
+      }
+
+      for ( uint16_t version = 0; version < 2000; version++ ) {
+        for ( uint32_t i = 0; i < neighbors; i++ ) {
+          if ( ( i + version ) % 5 == 0 ) {
+            table.erase( base + 1 + i );
+          } else {
+            table.store( base + 1 + i, mac_for( base + 1 + i, version ) );
+          }
+        }
+      }
+      done = true;
+      for ( auto& reader : readers ) {
+        reader.join();
+      }
+      expect( not torn, "a reader saw a torn mapping" );
+      expect( hits > 0, "readers never found anything" );
+    }
+
+    // a NetworkInterface keeps its shared table in step with its ARP cache
+    {
+      const EthernetAddress local { 0x02, 0, 0, 0, 0, 1 };
+      const EthernetAddress peer { 0x02, 0, 0, 0, 0, 2 };
+      const EthernetAddress other { 0x02, 0, 0, 0, 0, 3 };
+      NetworkInterface interface { local, Address { "10.0.0.1" } };
+
+      interface.recv_frame( arp_reply( peer, base + 2, local, base + 1 ) );
+      const auto shared = interface.share_neighbors();
+      expect( shared->find( base + 2 ) == MacAddress { peer }, "existing mapping not shared" );
+
+      interface.tick( 10000 );
+      interface.recv_frame( arp_reply( other, base + 3, local, base + 1 ) );
+      expect( shared->find( base + 3 ) == MacAddress { other }, "learned mapping not shared" );
+      expect( interface.share_neighbors() == shared, "table shared twice" );
+
+      // frames built from the shared table (as forwarding threads do) go out as sent
+      InternetDatagram dgram;
+      dgram.header.src = base + 1;
+      dgram.header.dst = base + 3;
+      dgram.header.tos = 46 << 2; // expedited forwarding
+      dgram.header.compute_checksum();
+      EthernetFrame frame;
+      expect( not interface.build_frame( dgram, base + 4, frame ), "frame built for an unknown neighbor" );
+      expect( interface.build_frame( dgram, base + 3, frame ), "frame not built for a known neighbor" );
+      expect( frame.header.dst == MacAddress { other } and frame.header.src == MacAddress { local }
+                and frame.header.type == EthernetHeader::TYPE_IPv4,
+              "built frame misaddressed" );
+      interface.send_frame( std::move( frame ), base + 3, dgram.header.tos );
+      const auto sent = interface.maybe_send();
+      InternetDatagram sent_dgram;
+      expect( sent.has_value() and sent->header.dst == MacAddress { other } and parse( sent_dgram, sent->payload )
+                and sent_dgram.header.dst == base + 3,
+              "built frame not sent" );
+
+      interface.tick( 20001 );
+      expect( not shared->find( base + 2 ).has_value(), "expired mapping still shared" );
+      expect( shared->find( base + 3 ).has_value(), "live mapping withdrawn" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,130 @@
+#include "spsc_ring.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "SpscRing: " + what );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // capacity rounds up, and a full ring refuses more (leaving the item alone)
+    {
+      SpscRing<unique_ptr<int>> ring { 3 };
+      expect( ring.capacity() == 4, "capacity not rounded up to a power of two" );
+      for ( int i = 0; i < 4; i++ ) {
+        expect( ring.push( make_unique<int>( i ) ), "push into a ring with room failed" );
+      }
+      auto extra = make_unique<int>( 4 );
+      expect( not ring.push( std::move( extra ) ), "push into a full ring succeeded" );
+      expect( extra != nullptr and *extra == 4, "refused item was moved from" );
+
+      unique_ptr<int> item;
+      for ( int i = 0; i < 4; i++ ) {
+        expect( ring.pop( item ) and *item == i, "items came out of order" );
+      }
+      expect( not ring.pop( item ), "pop from an empty ring succeeded" );
+    }
+
+    // batches stop at the ring's edges, and wrap around it
+    {
+      SpscRing<int> ring { 8 };
+      vector<int> items { 0, 1, 2, 3, 4, 5 };
+      vector<int> out( 5 );
+      expect( ring.push_batch( items ) == 6, "batch push into an empty ring stopped short" );
+      expect( ring.pop_batch( out ) == 5 and out == vector<int> { 0, 1, 2, 3, 4 }, "wrong batch popped" );
+      expect( ring.room() == 7, "wrong room left" );
+
+      items = { 6, 7, 8, 9, 10, 11, 12, 13, 14 };
+      expect( ring.push_batch( items ) == 7, "batch push overfilled the ring" );
+      out.assign( 10, -1 );
+      expect( ring.pop_batch( out ) == 8, "batch pop did not take everything" );
+      expect( out == vector<int> { 5, 6, 7, 8, 9, 10, 11, 12, -1, -1 }, "batch wrapped around wrongly" );
+      expect( ring.pop_batch( out ) == 0 and ring.room() == 8, "ring not empty after draining" );
+    }
+
+    // one producer and one consumer thread, with the ring often full and often empty
+    {
+      constexpr uint64_t count = 50000;
+      SpscRing<uint64_t> ring { 8 };
+      thread producer { [&] {
+        for ( uint64_t i = 0; i < count; i++ ) {
+          while ( not ring.push( uint64_t { i } ) ) {
+            this_thread::yield();
+          }
+        }
+      } };
+
+      uint64_t next = 0;
+      bool in_order = true;
+      while ( next < count ) {
+        uint64_t item = 0;
+        if ( ring.pop( item ) ) {
+          in_order = in_order and item == next;
+          ++next;
+        } else {
+          this_thread::yield();
+        }
+      }
+      producer.join();
+      expect( in_order, "items were lost, duplicated or reordered between threads" );
+    }
+
+    // the same, in batches of varying sizes
+    {
+      constexpr uint64_t count = 50000;
+      SpscRing<uint64_t> ring { 16 };
+      thread producer { [&] {
+        vector<uint64_t> batch;
+        for ( uint64_t next = 0; next < count; ) {
+          batch.clear();
+          for ( uint64_t i = next; i < min( count, next + 1 + next % 23 ); i++ ) {
+            batch.push_back( i );
+          }
+          const size_t pushed = ring.push_batch( batch );
+          next += pushed;
+          if ( pushed < batch.size() ) {
+            this_thread::yield();
+          }
+        }
+      } };
+
+      vector<uint64_t> batch( 11 );
+      uint64_t next = 0;
+      bool in_order = true;
+      while ( next < count ) {
+        const size_t popped = ring.pop_batch( span { batch }.first( 1 + next % batch.size() ) );
+        for ( size_t i = 0; i < popped; i++ ) {
+          in_order = in_order and batch[i] == next++;
+        }
+        if ( popped == 0 ) {
+          this_thread::yield();
+        }
+      }
+      producer.join();
+      expect( in_order, "batched items were lost, duplicated or reordered between threads" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
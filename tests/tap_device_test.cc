@@ -0,0 +1,98 @@
+#include "address.hh"
+#include "arp_message.hh"
+#include "exception.hh"
+#include "tap_device.hh"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <linux/if.h>
+#include <netinet/in.h>
+#include <optional>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "TapDevice: " + what );
+  }
+}
+
+// Give the kernel's end of the device an IPv4 address
+void set_address( const string& device, const string& address )
+{
+  const FileDescriptor control { CheckSystemCall( "socket", socket( AF_INET, SOCK_DGRAM, 0 ) ) };
+  ifreq request {};
+  device.copy( request.ifr_name, IFNAMSIZ - 1 );
+  sockaddr_in sin {};
+  sin.sin_family = AF_INET;
+  inet_pton( AF_INET, address.c_str(), &sin.sin_addr );
+  memcpy( &request.ifr_addr, &sin, sizeof( sin ) );
+  CheckSystemCall( "ioctl SIOCSIFADDR", ioctl( control.fd_num(), SIOCSIFADDR, &request ) ); // NOLINT(*-vararg)
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    optional<TapDevice> tap;
+    try {
+      tap.emplace();
+    } catch ( const unix_error& e ) {
+      cerr << "skipping TapDevice test: " << e.what() << endl;
+      return EXIT_SUCCESS; // no CAP_NET_ADMIN, or no /dev/net/tun
+    }
+    expect( not tap->name().empty(), "device has no name" );
+    set_address( tap->name(), "10.200.0.1" );
+    tap->set_up();
+
+    // ask the kernel (by ARP) for the Ethernet address of its end of the link
+    const EthernetAddress ours { 0x02, 0, 0, 0, 0x2a, 1 };
+    ARPMessage request;
+    request.opcode = ARPMessage::OPCODE_REQUEST;
+    request.sender_ethernet_address = ours;
+    request.sender_ip_address = Address { "10.200.0.2" }.ipv4_numeric();
+    request.target_ip_address = Address { "10.200.0.1" }.ipv4_numeric();
+    EthernetFrame frame;
+    frame.header = { ETHERNET_BROADCAST, ours, EthernetHeader::TYPE_ARP };
+    frame.payload = serialize( request );
+    const EthernetFrame batch[] = { frame, frame };
+    expect( tap->write_frames( batch ) == 2, "frames not written" );
+
+    // the reply comes back among whatever else the kernel sends on the new link
+    bool replied = false;
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds( 5 );
+    while ( not replied and chrono::steady_clock::now() < deadline ) {
+      pollfd readable { tap->fd_num(), POLLIN, 0 };
+      poll( &readable, 1, 100 );
+      vector<EthernetFrame> frames;
+      tap->read_frames( frames, 16 );
+      for ( const auto& received : frames ) {
+        ARPMessage reply;
+        if ( received.header.type == EthernetHeader::TYPE_ARP and parse( reply, received.payload )
+             and reply.opcode == ARPMessage::OPCODE_REPLY ) {
+          expect( received.header.dst == MacAddress { ours }, "reply sent to the wrong address" );
+          expect( reply.sender_ip_address == Address { "10.200.0.1" }.ipv4_numeric(), "reply for the wrong address" );
+          replied = true;
+        }
+      }
+    }
+    expect( replied, "no ARP reply from the kernel" );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,95 @@
+#include "timer_wheel.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "TimerWheel: " + what );
+  }
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    // timers fire on the first advance that reaches their expiry, never earlier
+    {
+      TimerWheel wheel { 1000 };
+      vector<TimerWheel::Timer> expired;
+
+      wheel.schedule( 1000 + 30001, 1, 0 );
+      wheel.schedule( 1000 + 5001, 2, 0 );
+      wheel.schedule( 1000 + 1, 3, 0 );
+      wheel.schedule( 500, 4, 0 ); // already in the past
+      expect( wheel.size() == 4, "wrong number of pending timers" );
+
+      wheel.advance( 1000, expired );
+      expect( expired.size() == 1 and expired[0].key == 4, "overdue timer did not fire immediately" );
+
+      expired.clear();
+      wheel.advance( 1000 + 5000, expired );
+      expect( expired.size() == 1 and expired[0].key == 3, "timers fired at the wrong time" );
+
+      expired.clear();
+      wheel.advance( 1000 + 30000, expired );
+      expect( expired.size() == 1 and expired[0].key == 2, "timers fired at the wrong time" );
+
+      expired.clear();
+      wheel.advance( 1000 + 30001, expired );
+      expect( expired.size() == 1 and expired[0].key == 1, "timers fired at the wrong time" );
+      expect( wheel.empty(), "timers left behind" );
+    }
+
+    // many timers over a wide range of delays, advanced in irregular steps
+    {
+      default_random_engine rng { random_device()() };
+      TimerWheel wheel;
+      vector<uint64_t> expiry;
+      vector<bool> fired;
+      vector<TimerWheel::Timer> expired;
+
+      for ( uint32_t i = 0; i < 20000; i++ ) {
+        const unsigned scale = uniform_int_distribution<unsigned> { 0, 32 }( rng );
+        expiry.push_back( uniform_int_distribution<uint64_t> { 0, uint64_t { 1 } << scale }( rng ) );
+        fired.push_back( false );
+        wheel.schedule( expiry.back(), i, 0 );
+      }
+
+      uint64_t now = 0;
+      while ( not wheel.empty() ) {
+        const unsigned scale = uniform_int_distribution<unsigned> { 0, 28 }( rng );
+        const uint64_t next = now + uniform_int_distribution<uint64_t> { 1, uint64_t { 1 } << scale }( rng );
+        expired.clear();
+        wheel.advance( next, expired );
+        for ( const auto& timer : expired ) {
+          expect( not fired.at( timer.key ), "timer fired twice" );
+          expect( timer.expiry == expiry.at( timer.key ), "timer expiry changed" );
+          expect( timer.expiry > now or now == 0, "timer fired late" );
+          expect( timer.expiry <= next, "timer fired early" );
+          fired.at( timer.key ) = true;
+        }
+        now = next;
+      }
+
+      for ( const bool f : fired ) {
+        expect( f, "timer never fired" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+#include "address.hh"
+#include "exception.hh"
+#include "socket.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "UDP batches: " + what );
+  }
+}
+
+UDPSocket bound_socket()
+{
+  UDPSocket socket;
+  socket.bind( Address { "127.0.0.1", 0 } );
+  return socket;
+}
+
+// Receive until `bytes` bytes have arrived, and return them (splitting GRO buffers apart)
+vector<string> receive( UDPSocket& socket, size_t bytes, unsigned& calls )
+{
+  vector<string> datagrams;
+  vector<string> buffers( 8 );
+  vector<Address> sources;
+  vector<size_t> segment_sizes( buffers.size() );
+  for ( size_t total = 0; total < bytes; ) {
+    const size_t count = socket.recv_batch( buffers, sources, segment_sizes );
+    ++calls;
+    for ( size_t i = 0; i < count; i++ ) {
+      total += buffers[i].size();
+      const size_t step = segment_sizes[i] ? segment_sizes[i] : buffers[i].size();
+      for ( size_t offset = 0; offset < buffers[i].size(); offset += step ) {
+        datagrams.push_back( buffers[i].substr( offset, step ) );
+      }
+    }
+  }
+  return datagrams;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    UDPSocket sender = bound_socket();
+    UDPSocket receiver = bound_socket();
+    const Address destination = receiver.local_address();
+
+    // a batch of datagrams of different sizes, in few system calls each way
+    {
+      constexpr size_t count = 100;
+      vector<string> payloads;
+      vector<pair<Address, string_view>> batch;
+      size_t bytes = 0;
+      for ( size_t i = 0; i < count; i++ ) {
+        payloads.push_back( to_string( i ) + string( i * 13 % 1400, 'a' + i % 26 ) );
+        bytes += payloads.back().size();
+      }
+      for ( const auto& payload : payloads ) {
+        batch.emplace_back( destination, payload );
+      }
+
+      const unsigned writes = sender.write_count();
+      expect( sender.send_batch( batch ) == count, "batch not sent" );
+      expect( sender.write_count() - writes <= 2, "too many system calls to send" );
+
+      vector<string> buffers( 32 );
+      vector<Address> sources;
+      vector<string> received;
+      unsigned calls = 0;
+      while ( received.size() < count ) {
+        const size_t n = receiver.recv_batch( buffers, sources );
+        ++calls;
+        expect( sources.size() == n, "wrong number of sources" );
+        for ( size_t i = 0; i < n; i++ ) {
+          expect( sources[i] == sender.local_address(), "wrong source address" );
+          received.push_back( buffers[i] );
+        }
+      }
+      expect( received == payloads, "datagrams lost, changed or reordered" );
+      expect( calls <= count / 16, "too many system calls to receive" );
+    }
+
+    // a datagram too large for its buffer is dropped (and counted), and the rest still arrive
+    {
+      const string oversized( 20000, 'o' ); // more than a buffer's default size
+      const pair<Address, string_view> batch[] { { destination, oversized }, { destination, "after" } };
+      expect( sender.send_batch( batch ) == 2, "batch not sent" );
+
+      vector<string> buffers( 4 );
+      vector<Address> sources;
+      size_t n = 0;
+      while ( n == 0 ) {
+        n = receiver.recv_batch( buffers, sources );
+      }
+      expect( n == 1 and sources.size() == 1 and buffers[0] == "after", "datagram after an oversized one lost" );
+      expect( receiver.truncated_datagrams() == 1, "oversized datagram not counted" );
+    }
+
+    // GSO: one large payload goes out as many datagrams (if the kernel supports it)
+    const string large = [] {
+      string s;
+      for ( int i = 0; i < 1000; i++ ) {
+        s.push_back( static_cast<char>( 'A' + i % 50 ) );
+      }
+      return s;
+    }();
+    bool gso = true;
+    try {
+      const pair<Address, string_view> one[] { { destination, large } };
+      sender.send_batch( one, 100 );
+    } catch ( const unix_error& e ) {
+      cerr << "skipping GSO/GRO checks: " << e.what() << endl;
+      gso = false;
+    }
+
+    if ( gso ) {
+      unsigned calls = 0;
+      const auto segments = receive( receiver, large.size(), calls );
+      expect( segments.size() == 10, "GSO payload not split into datagrams" );
+      for ( size_t i = 0; i < segments.size(); i++ ) {
+        expect( segments[i] == large.substr( i * 100, 100 ), "GSO datagram corrupted" );
+      }
+
+      // GRO: they may come back as one buffer, but split the same way
+      receiver.set_gro( true );
+      const pair<Address, string_view> one[] { { destination, string_view { large }.substr( 0, 950 ) } };
+      sender.send_batch( one, 100 );
+      calls = 0;
+      const auto coalesced = receive( receiver, 950, calls );
+      expect( coalesced.size() == 10 and coalesced.back() == large.substr( 900, 50 ), "GRO segments reported wrongly" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#include "udp_link.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void expect( bool condition, const string& what )
+{
+  if ( not condition ) {
+    throw runtime_error( "UdpLink: " + what );
+  }
+}
+
+// An address on localhost that is (very likely) free to bind
+Address free_address()
+{
+  UDPSocket probe;
+  probe.bind( Address { "127.0.0.1", 0 } );
+  return probe.local_address();
+}
+
+const EthernetAddress host_eth { 0x02, 0, 0, 0, 0, 1 };
+const EthernetAddress other_eth { 0x02, 0, 0, 0, 0, 2 };
+
+EthernetFrame make_frame( uint16_t type, const string& payload )
+{
+  EthernetFrame frame;
+  frame.header = { host_eth, other_eth, type };
+  frame.payload.emplace_back( payload );
+  return frame;
+}
+
+string flatten( const vector<Buffer>& buffers )
+{
+  string out;
+  for ( const auto& buffer : buffers ) {
+    out += static_cast<string_view>( buffer );
+  }
+  return out;
+}
+
+// Receive until `count` frames have arrived (or give up after a second)
+vector<EthernetFrame> recv_all( UdpLink& link, size_t count )
+{
+  vector<EthernetFrame> frames;
+  for ( int i = 0; i < 1000 and frames.size() < count; i++ ) {
+    if ( link.recv_frames( frames, count - frames.size() ) == 0 ) {
+      this_thread::sleep_for( chrono::milliseconds( 1 ) );
+    }
+  }
+  return frames;
+}
+
+} // namespace
+
+int main()
+{
+  try {
+    const Address a_address = free_address();
+    const Address b_address = free_address();
+    UdpLink a { a_address, b_address };
+    UdpLink b { b_address, a_address };
+
+    // frames arrive whole and in order, across several batches
+    {
+      vector<EthernetFrame> sent;
+      for ( size_t i = 0; i < 3 * UdpLink::BATCH + 5; i++ ) {
+        sent.push_back( make_frame( EthernetHeader::TYPE_IPv4, "frame " + to_string( i ) ) );
+      }
+      expect( a.send_frames( sent ) == sent.size(), "frames not sent" );
+
+      const vector<EthernetFrame> received = recv_all( b, sent.size() );
+      expect( received.size() == sent.size(), "frames lost" );
+      for ( size_t i = 0; i < sent.size(); i++ ) {
+        expect( received[i].header.type == EthernetHeader::TYPE_IPv4, "header mangled" );
+        expect( received[i].header.src == sent[i].header.src and received[i].header.dst == sent[i].header.dst,
+                "addresses mangled" );
+        expect( flatten( received[i].payload ) == "frame " + to_string( i ), "payload mangled or reordered" );
+      }
+    }
+
+    // datagrams from anywhere but the peer, and ones that are not frames, are dropped
+    {
+      UDPSocket stranger;
+      stranger.sendto( b_address, flatten( serialize( make_frame( EthernetHeader::TYPE_IPv4, "stranger" ) ) ) );
+      stranger.sendto( b_address, "not a frame" );
+      UdpLink other_port { free_address(), b_address };
+      other_port.send_frames( vector { make_frame( EthernetHeader::TYPE_IPv4, "other port" ) } );
+      a.send_frames( vector { make_frame( EthernetHeader::TYPE_IPv4, "peer" ) } );
+
+      this_thread::sleep_for( chrono::milliseconds( 10 ) );
+      vector<EthernetFrame> received;
+      b.recv_frames( received, SIZE_MAX );
+      expect( received.size() == 1 and flatten( received[0].payload ) == "peer", "foreign datagram accepted" );
+    }
+
+    // two interfaces resolve each other with ARP and exchange a datagram over the link
+    {
+      AsyncNetworkInterface host { host_eth, Address { "10.0.0.1" } };
+      AsyncNetworkInterface other { other_eth, Address { "10.0.0.2" } };
+
+      InternetDatagram dgram;
+      dgram.header.src = Address { "10.0.0.1" }.ipv4_numeric();
+      dgram.header.dst = Address { "10.0.0.2" }.ipv4_numeric();
+      dgram.payload.emplace_back( string { "hello" } );
+      dgram.header.len = static_cast<uint64_t>( dgram.header.hlen ) * 4 + 5;
+      dgram.header.compute_checksum();
+      host.send_datagram( dgram, Address { "10.0.0.2" } );
+
+      optional<InternetDatagram> received;
+      for ( int i = 0; i < 1000 and not received.has_value(); i++ ) {
+        a.exchange( host );
+        b.exchange( other );
+        received = other.maybe_receive();
+        this_thread::sleep_for( chrono::microseconds( 100 ) );
+      }
+      expect( received.has_value(), "datagram not delivered" );
+      expect( flatten( received->payload ) == "hello", "datagram mangled" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -9,7 +9,7 @@ using namespace std;
 bool ARPMessage::supported() const
 {
   return hardware_type == TYPE_ETHERNET and protocol_type == EthernetHeader::TYPE_IPv4
-         and hardware_address_size == sizeof( EthernetHeader::src )
+         and hardware_address_size == MacAddress::LENGTH
          and protocol_address_size == sizeof( IPv4Header::src )
          and ( ( opcode == OPCODE_REQUEST ) or ( opcode == OPCODE_REPLY ) );
 }
@@ -44,15 +44,11 @@ void ARPMessage::parse( Parser& parser )
   }
 
   // read sender addresses (Ethernet and IP)
-  for ( auto& b : sender_ethernet_address ) {
-    parser.integer( b );
-  }
+  sender_ethernet_address.parse( parser );
   parser.integer( sender_ip_address );
 
   // read target addresses (Ethernet and IP)
-  for ( auto& b : target_ethernet_address ) {
-    parser.integer( b );
-  }
+  target_ethernet_address.parse( parser );
   parser.integer( target_ip_address );
 }
 
@@ -69,14 +65,10 @@ void ARPMessage::serialize( Serializer& serializer ) const
   serializer.integer( opcode );
 
   // read sender addresses (Ethernet and IP)
-  for ( const auto& b : sender_ethernet_address ) {
-    serializer.integer( b );
-  }
+  sender_ethernet_address.serialize( serializer );
   serializer.integer( sender_ip_address );
 
   // read target addresses (Ethernet and IP)
-  for ( const auto& b : target_ethernet_address ) {
-    serializer.integer( b );
-  }
+  target_ethernet_address.serialize( serializer );
   serializer.integer( target_ip_address );
 }
@@ -14,14 +14,14 @@ struct ARPMessage
 
   uint16_t hardware_type = TYPE_ETHERNET;             // Type of the link-layer protocol (generally Ethernet/Wi-Fi)
   uint16_t protocol_type = EthernetHeader::TYPE_IPv4; // Type of the Internet-layer protocol (generally IPv4)
-  uint8_t hardware_address_size = sizeof( EthernetHeader::src );
+  uint8_t hardware_address_size = MacAddress::LENGTH;
   uint8_t protocol_address_size = sizeof( IPv4Header::src );
   uint16_t opcode {}; // Request or reply
 
-  EthernetAddress sender_ethernet_address {};
+  MacAddress sender_ethernet_address {};
   uint32_t sender_ip_address {};
 
-  EthernetAddress target_ethernet_address {};
+  MacAddress target_ethernet_address {};
   uint32_t target_ip_address {};
 
   // Return a string containing the ARP message in human-readable format
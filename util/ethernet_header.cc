@@ -19,6 +19,28 @@ string to_string( const EthernetAddress address )
   return ss.str();
 }
 
+//! \returns A string with a textual representation of a packed Ethernet address
+string to_string( const MacAddress address )
+{
+  return to_string( address.to_array() );
+}
+
+// An address is six bytes on the wire: read and write it as a 16-bit and a 32-bit integer
+void MacAddress::parse( Parser& parser )
+{
+  uint16_t high {};
+  uint32_t low {};
+  parser.integer( high );
+  parser.integer( low );
+  value_ = uint64_t { high } << 32 | low;
+}
+
+void MacAddress::serialize( Serializer& serializer ) const
+{
+  serializer.integer( static_cast<uint16_t>( value_ >> 32 ) );
+  serializer.integer( static_cast<uint32_t>( value_ ) );
+}
+
 //! \returns A string with the header's contents
 string EthernetHeader::to_string() const
 {
@@ -43,15 +65,9 @@ string EthernetHeader::to_string() const
 
 void EthernetHeader::parse( Parser& parser )
 {
-  // read destination address
-  for ( auto& b : dst ) {
-    parser.integer( b );
-  }
-
-  // read source address
-  for ( auto& b : src ) {
-    parser.integer( b );
-  }
+  // read destination and source addresses
+  dst.parse( parser );
+  src.parse( parser );
 
   // read frame type (e.g. IPv4, ARP, or something else)
   parser.integer( type );
@@ -59,15 +75,9 @@ void EthernetHeader::parse( Parser& parser )
 
 void EthernetHeader::serialize( Serializer& serializer ) const
 {
-  // write destination address
-  for ( const auto& b : dst ) {
-    serializer.integer( b );
-  }
-
-  // write source address
-  for ( const auto& b : src ) {
-    serializer.integer( b );
-  }
+  // write destination and source addresses
+  dst.serialize( serializer );
+  src.serialize( serializer );
 
   // write frame type (e.g. IPv4, ARP, or something else)
   serializer.integer( type );
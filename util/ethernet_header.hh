@@ -4,9 +4,10 @@
 
 #include <array>
 #include <cstdint>
+#include <functional>
 #include <string>
 
-// Helper type for an Ethernet address (an array of six bytes)
+// Helper type for an Ethernet address (an array of six bytes, in wire order)
 using EthernetAddress = std::array<uint8_t, 6>;
 
 // Ethernet broadcast address (ff:ff:ff:ff:ff:ff)
@@ -15,6 +16,77 @@ constexpr EthernetAddress ETHERNET_BROADCAST = { 0xff, 0xff, 0xff, 0xff, 0xff, 0
 // Printable representation of an EthernetAddress
 std::string to_string( EthernetAddress address );
 
+// An Ethernet address packed into the low 48 bits of an integer (the first byte on the wire
+// in bits 40-47), so that comparing, hashing or classifying one is a single integer operation.
+// Converts implicitly to and from EthernetAddress.
+class MacAddress
+{
+  uint64_t value_ {};
+
+  static constexpr uint64_t pack( const EthernetAddress& address )
+  {
+    uint64_t value = 0;
+    for ( const uint8_t b : address ) {
+      value = value << 8 | b;
+    }
+    return value;
+  }
+
+public:
+  static constexpr size_t LENGTH = 6;                             // length on the wire, in bytes
+  static constexpr uint64_t MASK = ( uint64_t { 1 } << 48 ) - 1; // the bits an address occupies
+
+  constexpr MacAddress() = default;
+
+  // NOLINTNEXTLINE(*-explicit-*)
+  constexpr MacAddress( const EthernetAddress& address ) : value_( pack( address ) ) {}
+
+  static constexpr MacAddress from_integer( const uint64_t value )
+  {
+    MacAddress address;
+    address.value_ = value & MASK;
+    return address;
+  }
+
+  constexpr uint64_t value() const { return value_; }
+
+  constexpr EthernetAddress to_array() const
+  {
+    EthernetAddress address {};
+    for ( size_t i = 0; i < address.size(); i++ ) {
+      address[i] = static_cast<uint8_t>( value_ >> ( 8 * ( address.size() - 1 - i ) ) );
+    }
+    return address;
+  }
+
+  // NOLINTNEXTLINE(*-explicit-*)
+  constexpr operator EthernetAddress() const { return to_array(); }
+
+  constexpr bool is_broadcast() const { return value_ == MASK; }
+
+  // Group (I/G) bit: the least significant bit of the first byte. Also true for broadcast.
+  constexpr bool is_multicast() const { return ( value_ >> 40 ) & 1; }
+
+  constexpr bool operator==( const MacAddress& other ) const = default;
+
+  void parse( Parser& parser );
+  void serialize( Serializer& serializer ) const;
+};
+
+// Printable representation of a MacAddress
+std::string to_string( MacAddress address );
+
+template<>
+struct std::hash<MacAddress>
+{
+  // Multiplicative mixing, folded so that the low bits depend on the whole address
+  size_t operator()( const MacAddress address ) const noexcept
+  {
+    const uint64_t mixed = address.value() * 0x9e3779b97f4a7c15;
+    return static_cast<size_t>( mixed ^ ( mixed >> 32 ) );
+  }
+};
+
 // Ethernet frame header
 struct EthernetHeader
 {
@@ -22,9 +94,9 @@ struct EthernetHeader
   static constexpr uint16_t TYPE_IPv4 = 0x800; //!< Type number for [IPv4](\ref rfc::rfc791)
   static constexpr uint16_t TYPE_ARP = 0x806;  //!< Type number for [ARP](\ref rfc::rfc826)
 
-  EthernetAddress dst;
-  EthernetAddress src;
-  uint16_t type;
+  MacAddress dst {};
+  MacAddress src {};
+  uint16_t type {};
 
   // Return a string containing a header in human-readable format
   std::string to_string() const;
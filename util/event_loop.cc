@@ -0,0 +1,188 @@
+#include "event_loop.hh"
+
+#include "exception.hh"
+
+#include <chrono>
+#include <stdexcept>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+constexpr size_t MAX_EVENTS = 64;
+} // namespace
+
+EventLoop::EventLoop()
+  : epoll_( ::CheckSystemCall( "epoll_create1", epoll_create1( EPOLL_CLOEXEC ) ) ), events_( MAX_EVENTS )
+{}
+
+uint64_t EventLoop::monotonic_ms()
+{
+  return chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+uint64_t EventLoop::monotonic_us()
+{
+  return chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+// fd_num: descriptor whose registration changed; operation: EPOLL_CTL_ADD or EPOLL_CTL_MOD
+void EventLoop::update( const int fd_num, const int operation )
+{
+  const Registration& registration = registrations_.at( fd_num );
+  epoll_event event {};
+  event.events = 0;
+  if ( *registration.on_readable ) {
+    event.events |= EPOLLIN;
+  }
+  if ( registration.write_interest ) {
+    event.events |= EPOLLOUT;
+  }
+  event.data.fd = fd_num;
+  ::CheckSystemCall( "epoll_ctl", epoll_ctl( epoll_.fd_num(), operation, fd_num, &event ) );
+}
+
+void EventLoop::add( const FileDescriptor& fd, Callback on_readable, Callback on_writable )
+{
+  if ( registrations_.contains( fd.fd_num() ) ) {
+    throw runtime_error( "EventLoop: file descriptor " + to_string( fd.fd_num() ) + " already registered" );
+  }
+
+  const bool write_interest = static_cast<bool>( on_writable );
+  registrations_.emplace(
+    fd.fd_num(),
+    Registration { fd.duplicate(),
+                   make_shared<Callback>( move( on_readable ) ),
+                   make_shared<Callback>( move( on_writable ) ),
+                   write_interest,
+                   true } );
+  try {
+    update( fd.fd_num(), EPOLL_CTL_ADD );
+  } catch ( ... ) {
+    registrations_.erase( fd.fd_num() );
+    throw;
+  }
+}
+
+void EventLoop::remove( const FileDescriptor& fd )
+{
+  remove( fd.fd_num() );
+}
+
+void EventLoop::remove( const int fd_num )
+{
+  if ( registrations_.erase( fd_num ) ) {
+    ::CheckSystemCall( "epoll_ctl", epoll_ctl( epoll_.fd_num(), EPOLL_CTL_DEL, fd_num, nullptr ) );
+  }
+}
+
+void EventLoop::set_write_interest( const FileDescriptor& fd, const bool enabled )
+{
+  Registration& registration = registrations_.at( fd.fd_num() );
+  if ( enabled and not *registration.on_writable ) {
+    throw runtime_error( "EventLoop: no write callback for file descriptor " + to_string( fd.fd_num() ) );
+  }
+  if ( registration.write_interest != enabled ) {
+    registration.write_interest = enabled;
+    update( fd.fd_num(), EPOLL_CTL_MOD );
+  }
+}
+
+void EventLoop::add_ticker( const uint64_t interval_ms, function<void( uint64_t )> on_tick )
+{
+  if ( interval_ms == 0 ) {
+    throw runtime_error( "EventLoop: ticker interval must be at least 1 ms" );
+  }
+
+  FileDescriptor timer { ::CheckSystemCall(
+    "timerfd_create", timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC ) ) }; // NOLINT(*-bitwise)
+  itimerspec period {};
+  period.it_interval.tv_sec = static_cast<time_t>( interval_ms / 1000 );
+  period.it_interval.tv_nsec = static_cast<long>( interval_ms % 1000 * 1000000 );
+  period.it_value = period.it_interval;
+  ::CheckSystemCall( "timerfd_settime", timerfd_settime( timer.fd_num(), 0, &period, nullptr ) );
+
+  add( timer, [fd_num = timer.fd_num(), last = monotonic_ms(), on_tick = move( on_tick )]() mutable {
+    uint64_t expirations {};
+    if ( ::read( fd_num, &expirations, sizeof( expirations ) ) != sizeof( expirations ) ) {
+      return; // already drained
+    }
+    const uint64_t now = monotonic_ms();
+    if ( now > last ) {
+      const uint64_t elapsed = now - last;
+      last = now;
+      on_tick( elapsed );
+    }
+  } );
+  registrations_.at( timer.fd_num() ).input = false;
+}
+
+bool EventLoop::wait_next_event( const int timeout_ms )
+{
+  if ( registrations_.empty() ) {
+    return false;
+  }
+
+  const int count = epoll_wait( epoll_.fd_num(), events_.data(), static_cast<int>( events_.size() ), timeout_ms );
+  if ( count < 0 ) {
+    if ( errno == EINTR ) {
+      return true;
+    }
+    throw unix_error { "epoll_wait" };
+  }
+  if ( timeout_ms == 0 ) {
+    ++statistics_.polls;
+    statistics_.empty_polls += count == 0;
+  } else {
+    ++statistics_.sleeps;
+  }
+
+  bool read_any = false;
+  for ( int i = 0; i < count; i++ ) {
+    const epoll_event& event = events_[i];
+
+    // look the registration up afresh each time, since an earlier callback may have removed it
+    // (a hangup or error is reported to the read callback, which will see EOF or the error)
+    auto it = registrations_.find( event.data.fd );
+    if ( it != registrations_.end() and ( event.events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) )
+         and *it->second.on_readable ) {
+      read_any = read_any or it->second.input;
+      const auto callback = it->second.on_readable;
+      ( *callback )();
+    }
+
+    it = registrations_.find( event.data.fd );
+    if ( it != registrations_.end() and ( event.events & EPOLLOUT ) and it->second.write_interest ) {
+      const auto callback = it->second.on_writable;
+      ( *callback )();
+    }
+
+    // if nothing is left to read, there is nothing more to wait for
+    if ( ( event.events & ( EPOLLERR | EPOLLHUP ) ) and not( event.events & EPOLLIN ) ) {
+      remove( event.data.fd );
+    }
+  }
+
+  if ( read_any ) {
+    ++statistics_.input_rounds;
+    if ( polling_idle_us_ > 0 ) {
+      last_input_us_ = monotonic_us();
+    }
+    if ( after_reads_ ) {
+      after_reads_();
+    }
+  }
+  return true;
+}
+
+void EventLoop::run()
+{
+  stopped_ = false;
+  while ( not stopped_ ) {
+    const bool polling = polling_idle_us_ > 0 and monotonic_us() - last_input_us_ < polling_idle_us_;
+    if ( not wait_next_event( polling ? 0 : -1 ) ) {
+      break;
+    }
+  }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "file_descriptor.hh"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
+
+// Waits for file descriptors to become readable or writable, and for periodic timers to fire,
+// and calls the callbacks registered for them ([epoll(7)](\ref man7::epoll), with timers from
+// [timerfd_create(2)](\ref man2::timerfd_create)). The loop sleeps in the kernel until
+// something happens, so an idle loop uses no CPU time.
+//
+// Callbacks may add and remove registrations (including their own).
+class EventLoop
+{
+public:
+  using Callback = std::function<void()>;
+
+  EventLoop();
+
+  // Call `on_readable` whenever `fd` is readable, and `on_writable` whenever it is writable
+  // and write interest is enabled (see set_write_interest(); enabled if `on_writable` is
+  // given). A hangup or error is passed to `on_readable` (which will read EOF or see the
+  // error), and then the descriptor is removed unless it still has data to read.
+  void add( const FileDescriptor& fd, Callback on_readable, Callback on_writable = {} );
+
+  // Stop watching `fd`
+  void remove( const FileDescriptor& fd );
+
+  // Whether `on_writable` should be called when `fd` is writable. A callback that has nothing
+  // to write should disable it, since a writable descriptor would otherwise wake the loop at
+  // once every time.
+  void set_write_interest( const FileDescriptor& fd, bool enabled );
+
+  // Call `on_tick( ms )` about every `interval_ms` milliseconds, with the time elapsed since
+  // the previous call (or since this one) on the monotonic clock, in whole milliseconds.
+  // Remainders carry over, so the elapsed times add up to the real time that has passed
+  // (e.g. for NetworkInterface::tick()).
+  void add_ticker( uint64_t interval_ms, std::function<void( uint64_t )> on_tick );
+
+  // Call `callback` once after each round of events in which any read callback (other than a
+  // ticker's) ran. For example, Router::route(): whatever was read from every descriptor is
+  // then routed together, and nothing is done when nothing arrived.
+  void after_reads( Callback callback ) { after_reads_ = std::move( callback ); }
+
+  // Wait up to `timeout_ms` milliseconds (or indefinitely, if negative) for events, and call
+  // their callbacks. Returns false if nothing is registered.
+  bool wait_next_event( int timeout_ms );
+
+  // Handle events until stop() is called (by a callback) or nothing is registered
+  void run();
+  void stop() { stopped_ = true; }
+
+  // Make run() poll for events without sleeping for as long as input keeps arriving, and go
+  // back to sleeping in epoll_wait() once none has arrived for `idle_us` microseconds. This
+  // trades a busy core for the latency of waking up, but only while there is traffic. 0 (the
+  // default) never polls. For sockets, see also Socket::set_busy_poll().
+  void set_polling( uint64_t idle_us ) { polling_idle_us_ = idle_us; }
+
+  // What the loop has done while waiting for events
+  struct Statistics
+  {
+    uint64_t polls = 0;        // waits that did not sleep (see set_polling())
+    uint64_t empty_polls = 0;  // ...of which found nothing
+    uint64_t sleeps = 0;       // waits that could sleep
+    uint64_t input_rounds = 0; // rounds of events in which input arrived
+  };
+  const Statistics& statistics() const { return statistics_; }
+
+  // Milliseconds and microseconds on the monotonic clock
+  static uint64_t monotonic_ms();
+  static uint64_t monotonic_us();
+
+private:
+  struct Registration
+  {
+    FileDescriptor fd;
+    // shared, so that a callback survives removing its own registration while it runs
+    std::shared_ptr<Callback> on_readable;
+    std::shared_ptr<Callback> on_writable;
+    bool write_interest;
+    bool input; // counts for after_reads() (tickers do not)
+  };
+
+  FileDescriptor epoll_;
+  std::unordered_map<int, Registration> registrations_ {};
+  std::vector<epoll_event> events_;
+  Callback after_reads_ {};
+  bool stopped_ = false;
+  uint64_t polling_idle_us_ = 0;
+  uint64_t last_input_us_ = 0;
+  Statistics statistics_ {};
+
+  void update( int fd_num, int operation );
+  void remove( int fd_num );
+};
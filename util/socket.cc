@@ -2,11 +2,19 @@
 
 #include "exception.hh"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cstddef>
+#include <cstring>
 #include <linux/if_packet.h>
 #include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <stdexcept>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 using namespace std;
@@ -151,6 +159,119 @@ void DatagramSocket::send( const string_view payload )
   register_write();
 }
 
+size_t DatagramSocket::recv_batch( span<string> payloads, vector<Address>& sources, span<size_t> segment_sizes )
+{
+  const size_t count = payloads.size();
+  if ( not segment_sizes.empty() and segment_sizes.size() < count ) {
+    throw runtime_error( "recv_batch: fewer segment sizes than payloads" );
+  }
+
+  // room for the senders, and for the GRO segment size of each datagram (a GRO receive can
+  // be as large as any datagram)
+  const bool gro = not segment_sizes.empty();
+  batch_addresses_.resize( count );
+  batch_controls_.resize( gro ? count : 0 );
+  batch_iovecs_.resize( count );
+  batch_messages_.resize( count );
+  for ( size_t i = 0; i < count; i++ ) {
+    payloads[i].reserve( gro ? kMaxDatagramSize : kReadBufferSize );
+    payloads[i].resize( payloads[i].capacity() );
+    batch_iovecs_[i] = { payloads[i].data(), payloads[i].size() };
+    msghdr& header = batch_messages_[i].msg_hdr;
+    header = {};
+    header.msg_name = static_cast<sockaddr*>( batch_addresses_[i] );
+    header.msg_namelen = sizeof( sockaddr_storage );
+    header.msg_iov = &batch_iovecs_[i];
+    header.msg_iovlen = 1;
+    if ( gro ) {
+      header.msg_control = batch_controls_[i].data();
+      header.msg_controllen = kControlSize;
+    }
+  }
+
+  const int received = CheckSystemCall(
+    "recvmmsg",
+    ::recvmmsg( fd_num(), batch_messages_.data(), static_cast<unsigned>( count ), MSG_WAITFORONE, nullptr ) );
+  register_read();
+
+  // keep the datagrams that fit (moving each down over any dropped before it)
+  sources.clear();
+  size_t kept = 0;
+  for ( int i = 0; i < received; i++ ) {
+    msghdr& header = batch_messages_[i].msg_hdr;
+    if ( header.msg_flags & MSG_TRUNC ) { // NOLINT(*-bitwise)
+      ++truncated_datagrams_;
+      continue;
+    }
+    payloads[i].resize( batch_messages_[i].msg_len );
+    sources.emplace_back( batch_addresses_[i], header.msg_namelen );
+
+    if ( gro ) {
+      segment_sizes[kept] = 0;
+      for ( cmsghdr* c = CMSG_FIRSTHDR( &header ); c != nullptr; c = CMSG_NXTHDR( &header, c ) ) {
+        if ( c->cmsg_level == SOL_UDP and c->cmsg_type == UDP_GRO ) {
+          int segment_size {};
+          memcpy( &segment_size, CMSG_DATA( c ), sizeof( segment_size ) );
+          segment_sizes[kept] = segment_size < static_cast<int>( batch_messages_[i].msg_len ) ? segment_size : 0;
+        }
+      }
+    }
+    if ( kept != static_cast<size_t>( i ) ) {
+      payloads[kept].swap( payloads[i] );
+    }
+    ++kept;
+  }
+  return kept;
+}
+
+size_t DatagramSocket::send_batch( span<const pair<Address, string_view>> datagrams, const uint16_t gso_segment_size )
+{
+  constexpr size_t control_size = CMSG_SPACE( sizeof( uint16_t ) );
+  static_assert( control_size <= kControlSize );
+  batch_controls_.resize( gso_segment_size > 0 ? datagrams.size() : 0 );
+  batch_iovecs_.resize( datagrams.size() );
+  batch_messages_.resize( datagrams.size() );
+  for ( size_t i = 0; i < datagrams.size(); i++ ) {
+    const auto& [destination, payload] = datagrams[i];
+    batch_iovecs_[i] = { const_cast<char*>( payload.data() ), payload.size() }; // NOLINT(*-const-cast)
+    msghdr& header = batch_messages_[i].msg_hdr;
+    header = {};
+    header.msg_name = const_cast<sockaddr*>( static_cast<const sockaddr*>( destination ) ); // NOLINT(*-const-cast)
+    header.msg_namelen = destination.size();
+    header.msg_iov = &batch_iovecs_[i];
+    header.msg_iovlen = 1;
+
+    if ( gso_segment_size > 0 ) {
+      header.msg_control = batch_controls_[i].data();
+      header.msg_controllen = control_size;
+      cmsghdr* c = CMSG_FIRSTHDR( &header );
+      c->cmsg_level = SOL_UDP;
+      c->cmsg_type = UDP_SEGMENT;
+      c->cmsg_len = CMSG_LEN( sizeof( uint16_t ) );
+      memcpy( CMSG_DATA( c ), &gso_segment_size, sizeof( gso_segment_size ) );
+    }
+  }
+
+  // the kernel may send fewer than asked (e.g. at most UIO_MAXIOV at once)
+  size_t sent = 0;
+  while ( sent < datagrams.size() ) {
+    const int count = CheckSystemCall(
+      "sendmmsg",
+      ::sendmmsg( fd_num(), batch_messages_.data() + sent, static_cast<unsigned>( datagrams.size() - sent ), 0 ) );
+    register_write();
+    if ( count == 0 ) {
+      break; // a non-blocking socket is full
+    }
+    sent += count;
+  }
+  return sent;
+}
+
+void UDPSocket::set_gro( const bool enabled )
+{
+  setsockopt( SOL_UDP, UDP_GRO, int { enabled } );
+}
+
 // mark the socket as listening for incoming connections
 //! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
 void TCPSocket::listen( const int backlog )
@@ -200,6 +321,11 @@ void Socket::set_reuseaddr()
   setsockopt( SOL_SOCKET, SO_REUSEADDR, int { true } );
 }
 
+void Socket::set_busy_poll( const unsigned microseconds )
+{
+  setsockopt( SOL_SOCKET, SO_BUSY_POLL, static_cast<int>( microseconds ) );
+}
+
 void Socket::throw_if_error() const
 {
   int socket_error = 0;
@@ -219,3 +345,250 @@ void PacketSocket::set_promiscuous()
               PACKET_ADD_MEMBERSHIP,
               packet_mreq { local_address().as<sockaddr_ll>()->sll_ifindex, PACKET_MR_PROMISC, {}, {} } );
 }
+
+void PacketSocket::bind_to_interface( const string& interface_name )
+{
+  // the protocol, as given to socket() (in network byte order)
+  int protocol {};
+  getsockopt( SOL_SOCKET, SO_PROTOCOL, protocol );
+
+  sockaddr_ll address {};
+  address.sll_family = AF_PACKET;
+  address.sll_protocol = static_cast<uint16_t>( protocol );
+  address.sll_ifindex = static_cast<int>( if_nametoindex( interface_name.c_str() ) );
+  if ( address.sll_ifindex == 0 ) {
+    throw unix_error { "if_nametoindex(" + interface_name + ")" };
+  }
+  bind( { reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) } ); // NOLINT(*-reinterpret-cast)
+}
+
+namespace {
+
+// An Ethernet header read from, or written to, the first EthernetHeader::LENGTH bytes of a frame
+// where it lies in a ring
+EthernetHeader load_ethernet_header( const char* bytes )
+{
+  const auto byte = [bytes]( const size_t i ) { return uint64_t { static_cast<uint8_t>( bytes[i] ) }; };
+  uint64_t dst = 0;
+  uint64_t src = 0;
+  for ( size_t i = 0; i < MacAddress::LENGTH; i++ ) {
+    dst = dst << 8 | byte( i );
+    src = src << 8 | byte( MacAddress::LENGTH + i );
+  }
+  return { MacAddress::from_integer( dst ), MacAddress::from_integer( src ), static_cast<uint16_t>( byte( 12 ) << 8 | byte( 13 ) ) };
+}
+
+void store_ethernet_header( const EthernetHeader& header, char* bytes )
+{
+  for ( size_t i = 0; i < MacAddress::LENGTH; i++ ) {
+    const size_t shift = 8 * ( MacAddress::LENGTH - 1 - i );
+    bytes[i] = static_cast<char>( header.dst.value() >> shift );
+    bytes[MacAddress::LENGTH + i] = static_cast<char>( header.src.value() >> shift );
+  }
+  bytes[12] = static_cast<char>( header.type >> 8 );
+  bytes[13] = static_cast<char>( header.type );
+}
+
+} // namespace
+
+// The RX and TX rings, mapped into memory shared with the kernel (RX ring first)
+struct PacketSocket::Rings
+{
+  RingConfig config;
+  uint32_t tx_block_size;
+  uint32_t tx_frames_per_block;
+  size_t size;
+  char* memory;
+
+  // position of the reader in the RX ring
+  uint32_t rx_block = 0;
+  bool in_block = false;  // rx_block has been handed over, and is partly read
+  uint32_t remaining = 0; // frames left to read in rx_block
+  const char* next_frame = nullptr;
+
+  uint32_t tx_slot = 0; // next TX slot to fill
+  RingStatistics statistics {};
+
+  Rings( const RingConfig& ring_config, uint32_t block_size, int fd_num )
+    : config( ring_config )
+    , tx_block_size( block_size )
+    , tx_frames_per_block( block_size / ring_config.frame_size )
+    , size( size_t { config.block_size } * config.block_count + size_t { tx_block_size } * tx_blocks() )
+    , memory( static_cast<char*>( mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_num, 0 ) ) )
+  {
+    if ( memory == MAP_FAILED ) { // NOLINT(*-cstyle-cast, *-int-to-ptr)
+      throw unix_error { "mmap" };
+    }
+  }
+
+  ~Rings() { munmap( memory, size ); }
+  Rings( const Rings& ) = delete;
+  Rings& operator=( const Rings& ) = delete;
+
+  uint32_t tx_blocks() const { return ( config.frame_count + tx_frames_per_block - 1 ) / tx_frames_per_block; }
+  uint32_t tx_slots() const { return tx_blocks() * tx_frames_per_block; }
+
+  tpacket_block_desc& rx( uint32_t block ) const
+  {
+    return *reinterpret_cast<tpacket_block_desc*>( memory + size_t { block } * config.block_size ); // NOLINT
+  }
+
+  tpacket3_hdr& tx( uint32_t slot ) const
+  {
+    char* const tx_ring = memory + size_t { config.block_size } * config.block_count;
+    return *reinterpret_cast<tpacket3_hdr*>( // NOLINT(*-reinterpret-cast)
+      tx_ring + size_t { slot / tx_frames_per_block } * tx_block_size
+      + size_t { slot % tx_frames_per_block } * config.frame_size );
+  }
+};
+
+void PacketSocket::enable_rings( const RingConfig& config )
+{
+  if ( rings_ ) {
+    throw runtime_error( "PacketSocket: rings already enabled" );
+  }
+  if ( config.frame_size < TPACKET3_HDRLEN + EthernetHeader::LENGTH or config.frame_size % TPACKET_ALIGNMENT != 0 ) {
+    throw runtime_error( "PacketSocket: invalid TX frame size" );
+  }
+
+  setsockopt( SOL_PACKET, PACKET_VERSION, int { TPACKET_V3 } );
+
+  // for RX, the kernel packs frames into blocks as they arrive; the frame size and count only
+  // have to be consistent with the blocks
+  tpacket_req3 rx {};
+  rx.tp_block_size = config.block_size;
+  rx.tp_block_nr = config.block_count;
+  rx.tp_frame_size = TPACKET_ALIGNMENT << 7;
+  rx.tp_frame_nr = static_cast<uint32_t>( uint64_t { config.block_size } * config.block_count / rx.tp_frame_size );
+  rx.tp_retire_blk_tov = config.block_timeout_ms;
+  setsockopt( SOL_PACKET, PACKET_RX_RING, rx );
+
+  // for TX, fixed-size slots, in blocks of at least a page
+  const uint32_t tx_block_size
+    = bit_ceil( max( config.frame_size, static_cast<uint32_t>( sysconf( _SC_PAGESIZE ) ) ) );
+  tpacket_req3 tx {};
+  tx.tp_block_size = tx_block_size;
+  tx.tp_frame_size = config.frame_size;
+  tx.tp_block_nr = ( config.frame_count + tx_block_size / config.frame_size - 1 ) / ( tx_block_size / config.frame_size );
+  tx.tp_frame_nr = tx.tp_block_nr * ( tx_block_size / config.frame_size );
+  setsockopt( SOL_PACKET, PACKET_TX_RING, tx );
+
+  rings_ = make_shared<Rings>( config, tx_block_size, fd_num() );
+}
+
+const PacketSocket::RingStatistics& PacketSocket::ring_statistics() const
+{
+  if ( not rings_ ) {
+    throw runtime_error( "PacketSocket: rings not enabled" );
+  }
+  return rings_->statistics;
+}
+
+size_t PacketSocket::recv_frames( vector<EthernetFrame>& frames, const size_t max )
+{
+  if ( not rings_ ) {
+    throw runtime_error( "PacketSocket: rings not enabled" );
+  }
+  Rings& rings = *rings_;
+
+  size_t count = 0;
+  while ( count < max ) {
+    tpacket_block_desc& block = rings.rx( rings.rx_block );
+    atomic_ref<uint32_t> status { block.hdr.bh1.block_status };
+    if ( not rings.in_block ) {
+      if ( not( status.load( memory_order_acquire ) & TP_STATUS_USER ) ) {
+        break; // the kernel is still filling it
+      }
+      rings.in_block = true;
+      rings.remaining = block.hdr.bh1.num_pkts;
+      rings.next_frame = reinterpret_cast<const char*>( &block ) + block.hdr.bh1.offset_to_first_pkt; // NOLINT
+    }
+
+    for ( ; rings.remaining > 0 and count < max; --rings.remaining ) {
+      const auto& header = *reinterpret_cast<const tpacket3_hdr*>( rings.next_frame ); // NOLINT
+      const string_view bytes { rings.next_frame + header.tp_mac, header.tp_snaplen };
+      rings.next_frame += header.tp_next_offset;
+
+      // the header is read where it lies; only the payload is copied out
+      if ( bytes.size() < EthernetHeader::LENGTH ) {
+        continue;
+      }
+      EthernetFrame frame;
+      frame.header = load_ethernet_header( bytes.data() );
+      frame.payload.emplace_back( string { bytes.substr( EthernetHeader::LENGTH ) } );
+      frames.push_back( move( frame ) );
+      ++count;
+    }
+
+    if ( rings.remaining > 0 ) {
+      break;
+    }
+
+    // every frame in the block has been read: give it back
+    status.store( TP_STATUS_KERNEL, memory_order_release );
+    rings.in_block = false;
+    rings.rx_block = ( rings.rx_block + 1 ) % rings.config.block_count;
+    ++rings.statistics.blocks_released;
+  }
+
+  register_read();
+  return count;
+}
+
+size_t PacketSocket::send_frames( const span<const EthernetFrame> frames )
+{
+  if ( not rings_ ) {
+    throw runtime_error( "PacketSocket: rings not enabled" );
+  }
+  Rings& rings = *rings_;
+
+  // frame data go after the slot's header (less the address the kernel does not need for TX)
+  constexpr size_t data_offset = TPACKET3_HDRLEN - sizeof( sockaddr_ll );
+
+  size_t consumed = 0;
+  size_t queued = 0;
+  for ( const auto& frame : frames ) {
+    tpacket3_hdr& slot = rings.tx( rings.tx_slot );
+    atomic_ref<uint32_t> status { slot.tp_status };
+    if ( status.load( memory_order_acquire ) != TP_STATUS_AVAILABLE ) {
+      break; // the ring is full
+    }
+
+    size_t length = EthernetHeader::LENGTH;
+    for ( const auto& buffer : frame.payload ) {
+      length += buffer.size();
+    }
+    ++consumed;
+    if ( data_offset + length > rings.config.frame_size ) {
+      ++rings.statistics.tx_oversized;
+      continue;
+    }
+
+    char* data = reinterpret_cast<char*>( &slot ) + data_offset; // NOLINT(*-reinterpret-cast)
+    store_ethernet_header( frame.header, data );
+    data += EthernetHeader::LENGTH;
+    for ( const auto& buffer : frame.payload ) {
+      const string_view bytes = buffer;
+      memcpy( data, bytes.data(), bytes.size() );
+      data += bytes.size();
+    }
+    slot.tp_len = static_cast<uint32_t>( length );
+    slot.tp_snaplen = static_cast<uint32_t>( length );
+    slot.tp_next_offset = 0;
+    status.store( TP_STATUS_SEND_REQUEST, memory_order_release );
+
+    rings.tx_slot = ( rings.tx_slot + 1 ) % rings.tx_slots();
+    ++queued;
+  }
+
+  // one system call to send the whole burst
+  if ( queued > 0 ) {
+    const ssize_t result = ::send( fd_num(), nullptr, 0, MSG_DONTWAIT );
+    if ( result < 0 and errno != EAGAIN and errno != ENOBUFS ) {
+      throw unix_error { "send (TX ring)" };
+    }
+    ++rings.statistics.tx_kicks;
+    register_write();
+  }
+  return consumed;
+}
@@ -1,11 +1,18 @@
 #pragma once
 
 #include "address.hh"
+#include "ethernet_frame.hh"
 #include "file_descriptor.hh"
 
+#include <array>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
 #include <sys/socket.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -54,6 +61,10 @@ public:
   //! Allow local address to be reused sooner via [SO_REUSEADDR](\ref man7::socket)
   void set_reuseaddr();
 
+  //! Busy-poll the device queue for up to `microseconds` when a receive finds nothing, via
+  //! [SO_BUSY_POLL](\ref man7::socket) (raising it above net.core.busy_poll needs CAP_NET_ADMIN)
+  void set_busy_poll( unsigned microseconds );
+
   //! Check for errors (will be seen on non-blocking sockets)
   void throw_if_error() const;
 };
@@ -62,6 +73,16 @@ class DatagramSocket : public Socket
 {
   using Socket::Socket;
 
+  //! Message headers (and what they point to) for recv_batch() and send_batch(), kept between
+  //! calls for their capacity
+  static constexpr size_t kControlSize = CMSG_SPACE( sizeof( int ) );
+  std::vector<Address::Raw> batch_addresses_ {};
+  std::vector<std::array<char, kControlSize>> batch_controls_ {};
+  std::vector<iovec> batch_iovecs_ {};
+  std::vector<mmsghdr> batch_messages_ {};
+
+  uint64_t truncated_datagrams_ = 0;
+
 public:
   //! Receive a datagram and the Address of its sender
   void recv( Address& source_address, std::string& payload );
@@ -71,6 +92,35 @@ public:
 
   //! Send datagram to the socket's connected address (must call connect() first)
   void send( std::string_view payload );
+
+  //! \brief Receive up to payloads.size() datagrams with one [recvmmsg(2)](\ref man2::recvmmsg)
+  //! \details Waits (unless the socket is non-blocking) for the first datagram, then takes
+  //! whatever others have already arrived. Each buffer is used to its capacity (raised to at
+  //! least kReadBufferSize if need be) and then resized to the datagram it received, so buffers
+  //! that are passed in again are not reallocated. `sources` is refilled with the senders.
+  //! With GRO on (see set_gro()), a buffer may hold several datagrams that arrived together,
+  //! each `segment_sizes[i]` bytes long except perhaps the last (0 if the buffer holds one);
+  //! buffers are raised to kMaxDatagramSize when segment sizes are asked for, so that a
+  //! coalesced receive fits. Datagrams too large for their buffer are dropped, and counted
+  //! (see truncated_datagrams()).
+  //! \returns the number of datagrams received (0 if a non-blocking socket had none, or if all
+  //! that arrived were dropped)
+  size_t recv_batch( std::span<std::string> payloads,
+                     std::vector<Address>& sources,
+                     std::span<size_t> segment_sizes = {} );
+
+  //! \brief Send each (destination, payload) pair as a datagram, with as few
+  //! [sendmmsg(2)](\ref man2::sendmmsg) calls as the kernel allows.
+  //! \details With `gso_segment_size` set, each payload is instead handed to the kernel in one
+  //! piece and sent as datagrams of that size (UDP GSO; the last may be shorter).
+  //! \returns the number of pairs sent (fewer than given only if a non-blocking socket fills up)
+  size_t send_batch( std::span<const std::pair<Address, std::string_view>> datagrams, uint16_t gso_segment_size = 0 );
+
+  //! Largest possible UDP datagram (or GRO receive), in bytes
+  static constexpr size_t kMaxDatagramSize = 65536;
+
+  //! Number of datagrams that recv_batch() has dropped for not fitting their buffers
+  uint64_t truncated_datagrams() const { return truncated_datagrams_; }
 };
 
 //! A wrapper around [UDP sockets](\ref man7::udp)
@@ -82,6 +132,10 @@ class UDPSocket : public DatagramSocket
 public:
   //! Default: construct an unbound, unconnected UDP socket
   UDPSocket() : DatagramSocket( AF_INET, SOCK_DGRAM ) {}
+
+  //! Let the kernel coalesce datagrams that arrive together from one sender into a single
+  //! receive (UDP GRO; see DatagramSocket::recv_batch() for how they are reported)
+  void set_gro( bool enabled );
 };
 
 //! A wrapper around [TCP sockets](\ref man7::tcp)
@@ -106,8 +160,52 @@ public:
 //! A wrapper around [packet sockets](\ref man7:packet)
 class PacketSocket : public DatagramSocket
 {
+  struct Rings;
+  std::shared_ptr<Rings> rings_ {};
+
 public:
   PacketSocket( const int type, const int protocol ) : DatagramSocket( AF_PACKET, type, protocol ) {}
 
   void set_promiscuous();
+
+  //! Bind to the network interface called `interface_name` (e.g. "eth0"), for both receiving and sending
+  void bind_to_interface( const std::string& interface_name );
+
+  //! Sizes of the memory-mapped rings (see enable_rings())
+  struct RingConfig
+  {
+    uint32_t block_size = 1 << 20;  //!< RX ring: bytes per block (a power of two, a multiple of the page size)
+    uint32_t block_count = 8;       //!< RX ring: number of blocks
+    uint32_t block_timeout_ms = 10; //!< RX ring: hand a partly filled block to the reader after this long
+    uint32_t frame_size = 2048;     //!< TX ring: bytes per slot (header included; a multiple of 16)
+    uint32_t frame_count = 512;     //!< TX ring: number of slots
+  };
+
+  //! \brief Receive and send through [PACKET_MMAP](\ref man7::packet) rings (TPACKET_V3) shared
+  //! with the kernel, instead of one recv()/sendto() call per frame.
+  //! \details The kernel fills RX blocks with frames and hands over each block as a whole;
+  //! recv_frames() parses frames where they lie and gives each block back once it has read
+  //! every frame in it. send_frames() fills free TX slots and then wakes the kernel once for
+  //! the whole burst. The socket should be bound first (see bind_to_interface()), and must be
+  //! of type SOCK_RAW, so that frames carry their Ethernet headers.
+  void enable_rings( const RingConfig& config );
+  void enable_rings() { enable_rings( RingConfig {} ); }
+
+  //! Append up to `max` received frames (as many as the kernel has handed over) to `frames`,
+  //! and return how many were appended (requires enable_rings())
+  size_t recv_frames( std::vector<EthernetFrame>& frames, size_t max );
+
+  //! Queue frames for transmission, in order, until the TX ring is full, and return how many
+  //! were taken (requires enable_rings()). Frames too large for a slot are taken but skipped
+  //! (and counted).
+  size_t send_frames( std::span<const EthernetFrame> frames );
+
+  //! Statistics of the rings
+  struct RingStatistics
+  {
+    uint64_t blocks_released = 0; //!< RX blocks handed back to the kernel
+    uint64_t tx_kicks = 0;        //!< system calls to start transmission
+    uint64_t tx_oversized = 0;    //!< frames skipped by send_frames() for not fitting a slot
+  };
+  const RingStatistics& ring_statistics() const;
 };
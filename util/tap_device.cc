@@ -0,0 +1,112 @@
+#include "tap_device.hh"
+
+#include "exception.hh"
+
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/if.h>
+#include <linux/if_tun.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+
+ifreq make_ifreq( const string& name )
+{
+  if ( name.size() >= IFNAMSIZ ) {
+    throw runtime_error( "TapDevice: interface name too long: " + name );
+  }
+  ifreq request {};
+  name.copy( request.ifr_name, IFNAMSIZ - 1 );
+  return request;
+}
+
+} // namespace
+
+// name: of the device to attach to (or create); empty to have the kernel choose one
+TapDevice::TapDevice( const string& name )
+  : FileDescriptor( ::CheckSystemCall( "open /dev/net/tun",
+                                       open( "/dev/net/tun", O_RDWR | O_NONBLOCK | O_CLOEXEC ) ) ) // NOLINT(*-bitwise)
+  , scratch_( MAX_FRAME_SIZE - EthernetHeader::LENGTH, 0 )
+{
+  ifreq request = make_ifreq( name );
+  request.ifr_flags = IFF_TAP | IFF_NO_PI; // NOLINT(*-bitwise)
+  CheckSystemCall( "ioctl TUNSETIFF", ioctl( fd_num(), TUNSETIFF, &request ) ); // NOLINT(*-vararg)
+  name_ = request.ifr_name;
+}
+
+void TapDevice::set_up( const bool up )
+{
+  // interface flags are set through any socket, not the device itself
+  const FileDescriptor control { ::CheckSystemCall( "socket", socket( AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0 ) ) };
+  ifreq request = make_ifreq( name_ );
+  ::CheckSystemCall( "ioctl SIOCGIFFLAGS", ioctl( control.fd_num(), SIOCGIFFLAGS, &request ) ); // NOLINT(*-vararg)
+  if ( up ) {
+    request.ifr_flags |= IFF_UP; // NOLINT(*-bitwise)
+  } else {
+    request.ifr_flags &= ~IFF_UP; // NOLINT(*-bitwise)
+  }
+  ::CheckSystemCall( "ioctl SIOCSIFFLAGS", ioctl( control.fd_num(), SIOCSIFFLAGS, &request ) ); // NOLINT(*-vararg)
+}
+
+size_t TapDevice::read_frames( vector<EthernetFrame>& frames, const size_t max )
+{
+  size_t count = 0;
+  array<char, EthernetHeader::LENGTH> header_bytes {};
+  while ( count < max ) {
+    // the header into its own small buffer, and the payload into the reusable scratch buffer
+    array<iovec, 2> iovecs { { { header_bytes.data(), header_bytes.size() }, { scratch_.data(), scratch_.size() } } };
+    const ssize_t length = ::readv( fd_num(), iovecs.data(), iovecs.size() );
+    if ( length < 0 ) {
+      if ( errno == EAGAIN or errno == EINTR ) {
+        break;
+      }
+      throw unix_error { "readv" };
+    }
+    register_read();
+    if ( length < static_cast<ssize_t>( EthernetHeader::LENGTH ) ) {
+      continue;
+    }
+
+    EthernetFrame frame;
+    if ( not parse( frame.header, { string { header_bytes.data(), header_bytes.size() } } ) ) {
+      continue;
+    }
+    frame.payload.emplace_back( string { scratch_.data(), length - EthernetHeader::LENGTH } );
+    frames.push_back( move( frame ) );
+    ++count;
+  }
+  return count;
+}
+
+size_t TapDevice::write_frames( span<const EthernetFrame> frames )
+{
+  size_t count = 0;
+  for ( const auto& frame : frames ) {
+    // the header is serialized on its own; the payload buffers are written where they are
+    const vector<Buffer> header = serialize( frame.header );
+    iovecs_.clear();
+    for ( const auto& buffers : { span { header }, span { frame.payload } } ) {
+      for ( const auto& buffer : buffers ) {
+        const string_view bytes = buffer;
+        iovecs_.push_back( { const_cast<char*>( bytes.data() ), bytes.size() } ); // NOLINT(*-const-cast)
+      }
+    }
+
+    const ssize_t written = ::writev( fd_num(), iovecs_.data(), static_cast<int>( iovecs_.size() ) );
+    if ( written < 0 ) {
+      if ( errno == EAGAIN or errno == EINTR ) {
+        break;
+      }
+      throw unix_error { "writev" };
+    }
+    register_write();
+    ++count;
+  }
+  return count;
+}
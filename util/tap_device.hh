@@ -0,0 +1,49 @@
+#pragma once
+
+#include "ethernet_frame.hh"
+#include "file_descriptor.hh"
+
+#include <span>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+// A Linux TAP device ([tuntap](\ref man4::tuntap), opened in IFF_TAP | IFF_NO_PI mode): a
+// virtual Ethernet link whose other end is the kernel's network stack. Frames the kernel
+// sends on the link are read here, and frames written here arrive at the kernel, so a
+// NetworkInterface attached to a TapDevice exchanges real traffic with the host (or, with
+// the device moved into a network namespace, with whatever lives there).
+//
+// The device is non-blocking. Frames are read and written in batches, one system call per
+// frame, with [readv(2)](\ref man2::readv) and [writev(2)](\ref man2::writev) scattering the
+// header and payload. Outgoing payloads are written where they are; incoming ones land in a
+// reused scratch buffer and are copied out at their exact size.
+// Opening a device needs CAP_NET_ADMIN.
+class TapDevice : public FileDescriptor
+{
+public:
+  // Attach to the TAP device called `name`, creating it if need be ("" lets the kernel
+  // choose a name, such as tap0)
+  explicit TapDevice( const std::string& name = "" );
+
+  // Name of the device (e.g. for ip(8))
+  const std::string& name() const { return name_; }
+
+  // Bring the link up, or take it down
+  void set_up( bool up = true );
+
+  // Read up to `max` frames (as many as are waiting), and append them to `frames`. Returns how
+  // many were appended; frames too short to have an Ethernet header are dropped.
+  size_t read_frames( std::vector<EthernetFrame>& frames, size_t max );
+
+  // Write frames (in order) until the device's queue is full, and return how many were written
+  size_t write_frames( std::span<const EthernetFrame> frames );
+
+  // Largest frame (header included) that read_frames() will receive whole
+  static constexpr size_t MAX_FRAME_SIZE = 16384;
+
+private:
+  std::string name_ {};
+  std::string scratch_;          // readv() target for payloads, allocated once
+  std::vector<iovec> iovecs_ {}; // for writev(), kept for its capacity
+};